@@ -0,0 +1,485 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_AHOCORASICK_HPP
+#define CPPEX3_AHOCORASICK_HPP
+//---------------DEFINES--------------
+#define ALPHABET_SIZE 256
+
+#define ROOT_STATE 0
+
+#define NO_STATE (-1)
+
+#define PREFILTER_MAX_BYTES 32
+
+#include <climits>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <vector>
+#include "ByteKernels.hpp"
+#include "InternedStringMap.hpp"
+
+/**
+ * Table of patterns and their weights. The phrases are interned in one arena, so a large
+ * database costs no allocation per phrase, and every entry keeps its StringHash so a resize
+ * while loading never hashes a phrase again.
+ */
+typedef InternedStringMap<int> PatternTable;
+
+/**
+ * Multi pattern matcher compiled from a table of weighted patterns.
+ * The automaton is stored as a dense transition table over byte classes (every byte that does
+ * not appear in any pattern shares class 0), and every state keeps the summed weight of all the
+ * patterns that end in it, so scoring a text is one table lookup and one add per byte.
+ * Matching is ASCII case insensitive: upper case letters share the class of their lower case
+ * letter, so the text is folded on the fly while it is scanned.
+ * While the automaton is in the root state, only a byte that starts a pattern can move it, so
+ * when few bytes do the scanner jumps straight to the next one with a vector kernel. If no
+ * pattern is one byte long the jump also needs the byte after it to continue some pattern,
+ * anything else leaves the automaton where starting over from the root would.
+ */
+class AhoCorasick
+{
+public:
+    /**
+     * Def const, matches nothing. A view over static arrays, so it allocates nothing.
+     */
+    AhoCorasick () : AhoCorasick (1 , 1 , NO_CLASSES , ROOT_ROW , NO_WEIGHTS)
+    {
+    }
+
+    /**
+     * View over an automaton stored elsewhere, e.g. in a mapped compiled database, nothing is
+     * copied so the arrays must outlive the view.
+     * @param classes Amount of byte classes
+     * @param states Amount of states
+     * @param classTable Class of every byte value, ALPHABET_SIZE entries
+     * @param transitions Transition table, states * classes entries
+     * @param weights Summed weight of every state, states entries
+     */
+    AhoCorasick (int classes , int states , const unsigned char *classTable ,
+                 const int32_t *transitions , const int32_t *weights) : _classes (classes) ,
+                                                                         _states (states) ,
+                                                                         _classOf (classTable) ,
+                                                                         _delta (transitions) ,
+                                                                         _out (weights)
+    {
+        _prepare ();
+    }
+
+    AhoCorasick (const AhoCorasick & other) = delete;
+
+    AhoCorasick & operator= (const AhoCorasick & other) = delete;
+
+    /**
+     * Move Constcutor, the moved vectors keep their buffers so the views stay valid
+     * @param other Automaton to move
+     */
+    AhoCorasick (AhoCorasick && other) noexcept = default;
+
+    /**
+     * Move assignment
+     * @param other Automaton to move
+     * @return This automaton
+     */
+    AhoCorasick & operator= (AhoCorasick && other) noexcept = default;
+
+    /**
+     * Compiles the automaton from a table of patterns and weights
+     * @param table Map of pattern to its weight
+     */
+    explicit AhoCorasick (const PatternTable & table) : _classes (1) ,
+                                                        classOf (ALPHABET_SIZE , 0)
+    {
+        std::vector<std::pair<std::string , int>> patterns;
+        for (const auto & i : table)
+        {
+            patterns.emplace_back (std::string (i.first) , i.second);
+        }
+        _build (patterns);
+        _point ();
+    }
+
+    /**
+     * Sums the weights of all the pattern appearances in the text, overlapping appearances
+     * are all counted.
+     * @param text Text to scan
+     * @param length Length of the text
+     * @return Final score of the text
+     */
+    int score (const char *text , size_t length) const
+    {
+        Scanner scanner (*this);
+        scanner.feed (text , length);
+        return scanner.score ();
+    }
+
+    /**
+     * Sums the weights of all the pattern appearances in the text
+     * @param text Text to scan
+     * @return Final score of the text
+     */
+    int score (const std::string & text) const
+    {
+        return score (text.data () , text.size ());
+    }
+
+    /**
+     * Scores a text that arrives in chunks. The current state of the automaton is the only
+     * thing carried from one chunk to the next, it stands for the longest pattern prefix the
+     * text ends with, so patterns that span a chunk boundary are still found and the score is
+     * the same as scanning the whole text at once.
+     * Weights are never negative, so once the score reaches the limit it can only grow and the
+     * scanner stops, the rest of the text does not change the verdict.
+     */
+    class Scanner
+    {
+    public:
+        /**
+         * Constructor
+         * @param matcher Automaton to scan with, must outlive the scanner
+         * @param limit Score at which scanning stops, INT_MAX to scan everything
+         */
+        explicit Scanner (const AhoCorasick & matcher , int limit = INT_MAX) : matcher (matcher) ,
+                                                                              limit (limit) ,
+                                                                              state (ROOT_STATE) ,
+                                                                              sum (0)
+        {
+        }
+
+        /**
+         * Scans the next chunk of the text, stopping right after the byte that makes the score
+         * reach the limit
+         * @param text Chunk to scan
+         * @param length Length of the chunk
+         * @return Amount of bytes scanned
+         */
+        size_t feed (const char *text , size_t length)
+        {
+            if (reached ())
+            {
+                return 0;
+            }
+            const int classes = matcher._classes;
+            const unsigned char *classOf = matcher._classOf;
+            const int32_t *delta = matcher._delta;
+            const int32_t *out = matcher._out;
+            const ByteSet *second = matcher.pairs ? &matcher.secondBytes : nullptr;
+            const bool prefilter = matcher.prefilter;
+            int current = state;
+            int total = sum;
+            for (size_t i = 0 ; i < length ; ++ i)
+            {
+                if (current == ROOT_STATE && prefilter)
+                {
+                    i += ByteKernels::findPair (text + i , length - i , matcher.firstBytes ,
+                                                second);
+                    if (i == length)
+                    {
+                        break;
+                    }
+                }
+                current = delta[current * classes + classOf[(unsigned char) text[i]]];
+                int weight = out[current];
+                if (weight != 0)
+                {
+                    total += weight;
+                    if (total >= limit)
+                    {
+                        state = current;
+                        sum = total;
+                        return i + 1;
+                    }
+                }
+            }
+            state = current;
+            sum = total;
+            return length;
+        }
+
+        /**
+         * Checks if the score reached the limit
+         * @return true if reached false otherwise
+         */
+        bool reached () const
+        {
+            return sum >= limit;
+        }
+
+        /**
+         * Score of the text scanned so far
+         * @return Score of the text scanned so far
+         */
+        int score () const
+        {
+            return sum;
+        }
+
+    private:
+        /**
+         * automaton to scan with
+         */
+        const AhoCorasick & matcher;
+        /**
+         * score at which scanning stops
+         */
+        int limit;
+        /**
+         * state after the last scanned byte
+         */
+        int state;
+        /**
+         * score of the text scanned so far
+         */
+        int sum;
+    };
+
+    /**
+     * Amount of states in the automaton
+     * @return Amount of states
+     */
+    int states () const
+    {
+        return _states;
+    }
+
+    /**
+     * Amount of byte classes
+     * @return Amount of byte classes
+     */
+    int classes () const
+    {
+        return _classes;
+    }
+
+    /**
+     * Class of every byte value
+     * @return ALPHABET_SIZE classes
+     */
+    const unsigned char *classTable () const
+    {
+        return _classOf;
+    }
+
+    /**
+     * Transition table
+     * @return states () * classes () transitions
+     */
+    const int32_t *transitions () const
+    {
+        return _delta;
+    }
+
+    /**
+     * Summed weight of every state
+     * @return states () weights
+     */
+    const int32_t *weights () const
+    {
+        return _out;
+    }
+
+private:
+    /**
+     * class of every byte in the automaton that matches nothing
+     */
+    static constexpr unsigned char NO_CLASSES[ALPHABET_SIZE] = {};
+    /**
+     * transitions of its only state, the root, which it never leaves
+     */
+    static constexpr int32_t ROOT_ROW[1] = {ROOT_STATE};
+    /**
+     * weight of its only state
+     */
+    static constexpr int32_t NO_WEIGHTS[1] = {0};
+
+    /**
+     * amount of byte classes, the row width of the transition table
+     */
+    int _classes;
+    /**
+     * amount of states
+     */
+    int _states;
+    /**
+     * views used while scanning, into the vectors below or into external memory
+     */
+    const unsigned char *_classOf;
+    const int32_t *_delta;
+    const int32_t *_out;
+    /**
+     * bytes that move the automaton out of the root state
+     */
+    ByteSet firstBytes;
+    /**
+     * bytes that continue a pattern after one of the first bytes
+     */
+    ByteSet secondBytes;
+    /**
+     * true if the scanner skips to the first bytes while in the root state
+     */
+    bool prefilter;
+    /**
+     * true if the skip also checks the second bytes, only if no pattern is one byte long
+     */
+    bool pairs;
+    /**
+     * class of every byte value
+     */
+    std::vector<unsigned char> classOf;
+    /**
+     * transition table, row per state and column per byte class
+     */
+    std::vector<int32_t> delta;
+    /**
+     * summed weight of the patterns ending in every state, including the ones reached by
+     * failure links
+     */
+    std::vector<int32_t> out;
+
+    /**
+     * Points the views at the owned vectors
+     */
+    void _point ()
+    {
+        _states = (int) out.size ();
+        _classOf = classOf.data ();
+        _delta = delta.data ();
+        _out = out.data ();
+        _prepare ();
+    }
+
+    /**
+     * Fills the byte sets of the root prefilter from the views
+     */
+    void _prepare ()
+    {
+        bool first[ALPHABET_SIZE] = {};
+        bool second[ALPHABET_SIZE] = {};
+        bool follows[ALPHABET_SIZE] = {};
+        int members = 0;
+        pairs = true;
+        for (int c = 0 ; c < _classes ; ++ c)
+        {
+            int next = _delta[ROOT_STATE * _classes + c];
+            if (next == ROOT_STATE)
+            {
+                continue;
+            }
+            pairs = pairs && _out[next] == 0;
+            for (int d = 0 ; d < _classes ; ++ d)
+            {
+                // any other follower lands where it would have from the root
+                if (_delta[next * _classes + d] != _delta[ROOT_STATE * _classes + d])
+                {
+                    follows[d] = true;
+                }
+            }
+        }
+        for (int b = 0 ; b < ALPHABET_SIZE ; ++ b)
+        {
+            first[b] = _delta[ROOT_STATE * _classes + _classOf[b]] != ROOT_STATE;
+            second[b] = follows[_classOf[b]];
+            members += first[b] ? 1 : 0;
+        }
+        prefilter = members > 0 && members <= PREFILTER_MAX_BYTES;
+        firstBytes = ByteKernels::makeSet (first);
+        secondBytes = ByteKernels::makeSet (second);
+    }
+
+    /**
+     * Folds an ASCII upper case letter to lower case
+     * @param c Byte to fold
+     * @return The folded byte
+     */
+    static unsigned char _fold (char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? (unsigned char) (c - 'A' + 'a') : (unsigned char) c;
+    }
+
+    /**
+     * Builds the trie, then fills the missing transitions by following the failure links
+     * in BFS order.
+     * @param patterns Patterns and their weights
+     */
+    void _build (const std::vector<std::pair<std::string , int>> & patterns)
+    {
+        for (const auto & pattern : patterns)
+        {
+            for (char c : pattern.first)
+            {
+                if (classOf[_fold (c)] == 0)
+                {
+                    classOf[_fold (c)] = (unsigned char) _classes ++;
+                }
+            }
+        }
+        // upper case letters are folded before they get a class, so at most the other 230 bytes
+        // get one besides class 0: _classes stays below ALPHABET_SIZE, which classOf entries and
+        // the follows set of _prepare need (testEveryByte builds that maximum)
+        for (int c = 'A' ; c <= 'Z' ; ++ c)
+        {
+            classOf[c] = classOf[_fold ((char) c)];
+        }
+        delta.assign (_classes , NO_STATE);
+        out.assign (1 , 0);
+        for (const auto & pattern : patterns)
+        {
+            if (pattern.first.empty ())
+            {
+                continue;
+            }
+            int state = ROOT_STATE;
+            for (char c : pattern.first)
+            {
+                int &next = delta[state * _classes + classOf[_fold (c)]];
+                if (next == NO_STATE)
+                {
+                    next = (int) out.size ();
+                    out.push_back (0);
+                    delta.resize (delta.size () + _classes , NO_STATE);
+                }
+                state = delta[state * _classes + classOf[_fold (c)]];
+            }
+            out[state] += pattern.second;
+        }
+        std::vector<int> fail (out.size () , ROOT_STATE);
+        std::queue<int> order;
+        for (int c = 0 ; c < _classes ; ++ c)
+        {
+            int &next = delta[c];
+            if (next == NO_STATE)
+            {
+                next = ROOT_STATE;
+            }
+            else
+            {
+                order.push (next);
+            }
+        }
+        while (! order.empty ())
+        {
+            int state = order.front ();
+            order.pop ();
+            out[state] += out[fail[state]];
+            for (int c = 0 ; c < _classes ; ++ c)
+            {
+                int &next = delta[state * _classes + c];
+                int fallback = delta[fail[state] * _classes + c];
+                if (next == NO_STATE)
+                {
+                    next = fallback;
+                }
+                else
+                {
+                    fail[next] = fallback;
+                    order.push (next);
+                }
+            }
+        }
+    }
+};
+
+#endif //CPPEX3_AHOCORASICK_HPP
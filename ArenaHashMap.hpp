@@ -0,0 +1,76 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_ARENAHASHMAP_HPP
+#define CPPEX3_ARENAHASHMAP_HPP
+//---------------DEFINES--------------
+#define ARENA_BLOCK (1 << 20)
+
+#include <memory_resource>
+#include <utility>
+#include "HashMap.hpp"
+
+/**
+ * Owner of the arena of an ArenaHashMap, a base of it so the arena is built before the map and
+ * destroyed after it
+ */
+class ArenaResource
+{
+protected:
+    /**
+     * Constructor
+     * @param blockSize Size of the first block of the arena
+     */
+    explicit ArenaResource (size_t blockSize) : arena (blockSize)
+    {
+    }
+
+    /**
+     * the arena, its blocks grow geometrically and are only freed all at once
+     */
+    std::pmr::monotonic_buffer_resource arena;
+};
+
+template<typename KeyT , typename ValueT , typename Hash = KeyHash<KeyT> ,
+        typename KeyEqual = std::equal_to<> , bool CacheHash = false>
+/**
+ * HashMap that takes all its memory from one monotonic arena: the bucket array, the buckets, and
+ * keys and values that are pmr aware (e.g. std::pmr::string). Building a table costs a handful of
+ * block allocations instead of one malloc per bucket and per key, and destroying it frees the
+ * blocks at once.
+ * Memory given back by erase or by a resize is only reclaimed when the map is destroyed, so this
+ * fits tables that are built once, e.g. after a reserve, and dropped whole. The arena is not
+ * thread safe, so bulk inserts are never spread over threads.
+ * The map points into its own arena, so it can not be copied or moved itself, but pairs can be
+ * copied or moved into it through the HashMap assignments.
+ * @tparam KeyT type of Key
+ * @tparam ValueT type of Value
+ * @tparam Hash type of the hash of the keys
+ * @tparam KeyEqual type of the equality of the keys
+ * @tparam CacheHash true to store the hash of every key with its pair
+ */
+class ArenaHashMap : private ArenaResource ,
+                     public HashMap<KeyT , ValueT , Hash , KeyEqual , CacheHash ,
+                             std::pmr::polymorphic_allocator<std::pair<KeyT , ValueT>>>
+{
+public:
+    /**
+     * Def const
+     * @param blockSize Size of the first block of the arena
+     */
+    explicit ArenaHashMap (size_t blockSize = ARENA_BLOCK) : ArenaResource (blockSize) ,
+                                                             HashMap<KeyT , ValueT , Hash ,
+                                                                     KeyEqual , CacheHash ,
+                                                                     std::pmr::polymorphic_allocator<std::pair<KeyT , ValueT>>> (
+                                                                     Hash () , KeyEqual () ,
+                                                                     &arena)
+    {
+    }
+
+    ArenaHashMap (const ArenaHashMap & other) = delete;
+
+    ArenaHashMap & operator= (const ArenaHashMap & other) = delete;
+};
+
+#endif //CPPEX3_ARENAHASHMAP_HPP
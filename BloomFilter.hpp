@@ -0,0 +1,204 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_BLOOMFILTER_HPP
+#define CPPEX3_BLOOMFILTER_HPP
+//---------------DEFINES--------------
+#define BLOOM_BLOCK_BITS 512
+
+#define BLOOM_WORD_BITS 64
+
+#define BLOOM_MAX_HASHES 16
+
+#define BLOOM_MAX_BITS_PER_KEY 64.0
+
+#define BLOOM_BITS_STEP 0.25
+
+#define BLOOM_LN2 0.6931471805599453
+
+#define BLOOM_POSITION_SHIFT 55
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "HashMap.hpp"
+
+/**
+ * Blocked Bloom filter over the hashes of the keys of a table, so most keys that are not in the
+ * table are told apart without probing it. Every key sets and checks its bits inside a single
+ * block of one cache line, picked by the top bits of its mixed hash, so a check reads one cache
+ * line however many bits it tests.
+ * The filter is sized for a false positive rate: blocks fill up unevenly, so the bits per key
+ * are raised from those of a plain Bloom filter until the expected rate of the blocked one,
+ * averaged over the Poisson spread of keys per block, is at most the one asked for.
+ */
+class BloomFilter
+{
+public:
+    /**
+     * Def const, an empty filter that lets every key through
+     */
+    BloomFilter () : _hashes (0)
+    {
+    }
+
+    /**
+     * Constructor
+     * @param keys Amount of keys that will be inserted
+     * @param falsePositiveRate Rate of missing keys to let through, between 0 and 1
+     */
+    BloomFilter (size_t keys , double falsePositiveRate) : _hashes (1)
+    {
+        // bits per key of a plain Bloom filter with the best amount of hashes
+        double bitsPerKey = - std::log (falsePositiveRate) / (BLOOM_LN2 * BLOOM_LN2);
+        bitsPerKey = std::max (1.0 , bitsPerKey);
+        while (bitsPerKey < BLOOM_MAX_BITS_PER_KEY &&
+               _expectedRate (bitsPerKey , _hashesFor (bitsPerKey)) > falsePositiveRate)
+        {
+            bitsPerKey += BLOOM_BITS_STEP;
+        }
+        _hashes = _hashesFor (bitsPerKey);
+        size_t bits = (size_t) std::ceil ((double) std::max (keys , (size_t) 1) * bitsPerKey);
+        blocks.resize ((bits + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS);
+    }
+
+    /**
+     * Adds a key
+     * @param hash Hash of the key
+     */
+    void insert (size_t hash)
+    {
+        uint64_t mixed = mixHash (hash);
+        Block & block = blocks[_blockOf (mixed)];
+        uint64_t position = mixed;
+        for (int i = 0 ; i < _hashes ; ++ i)
+        {
+            // every multiply brings fresh bits to the top, the bit is picked by them
+            position *= STRING_HASH_SEED;
+            uint32_t bit = (uint32_t) (position >> BLOOM_POSITION_SHIFT);
+            block.words[bit / BLOOM_WORD_BITS] |= (uint64_t) 1 << (bit % BLOOM_WORD_BITS);
+        }
+    }
+
+    /**
+     * Checks if a key may have been added
+     * @param hash Hash of the key
+     * @return false if the key was surely not added, true otherwise
+     */
+    bool mayContain (size_t hash) const
+    {
+        if (blocks.empty ())
+        {
+            return true;
+        }
+        uint64_t mixed = mixHash (hash);
+        const Block & block = blocks[_blockOf (mixed)];
+        uint64_t position = mixed;
+        for (int i = 0 ; i < _hashes ; ++ i)
+        {
+            // every multiply brings fresh bits to the top, the bit is picked by them
+            position *= STRING_HASH_SEED;
+            uint32_t bit = (uint32_t) (position >> BLOOM_POSITION_SHIFT);
+            uint64_t mask = (uint64_t) 1 << (bit % BLOOM_WORD_BITS);
+            if ((block.words[bit / BLOOM_WORD_BITS] & mask) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Checks if the filter lets every key through
+     * @return true if empty false otherwise
+     */
+    bool empty () const
+    {
+        return blocks.empty ();
+    }
+
+    /**
+     * Size of the filter
+     * @return Amount of bits
+     */
+    size_t bits () const
+    {
+        return blocks.size () * BLOOM_BLOCK_BITS;
+    }
+
+    /**
+     * Amount of bits set and checked per key
+     * @return Amount of bits set and checked per key
+     */
+    int hashes () const
+    {
+        return _hashes;
+    }
+
+private:
+    /**
+     * A block of bits on a cache line of its own
+     */
+    struct alignas (BLOOM_BLOCK_BITS / CHAR_BIT) Block
+    {
+        uint64_t words[BLOOM_BLOCK_BITS / BLOOM_WORD_BITS] = {};
+    };
+
+    /**
+     * the blocks
+     */
+    std::vector<Block> blocks;
+    /**
+     * amount of bits set and checked per key
+     */
+    int _hashes;
+
+    /**
+     * Block of a mixed hash, by its top bits
+     * @param mixed Mixed hash of the key
+     * @return Index of the block
+     */
+    size_t _blockOf (uint64_t mixed) const
+    {
+        return (size_t) (((mixed >> 32) * (uint64_t) blocks.size ()) >> 32);
+    }
+
+    /**
+     * Amount of hashes with the lowest false positive rate for a plain Bloom filter
+     * @param bitsPerKey Bits of the filter per key
+     * @return Amount of bits set and checked per key
+     */
+    static int _hashesFor (double bitsPerKey)
+    {
+        int hashes = (int) std::lround (bitsPerKey * BLOOM_LN2);
+        return std::min (BLOOM_MAX_HASHES , std::max (1 , hashes));
+    }
+
+    /**
+     * Expected false positive rate of the blocked filter: a block holds a Poisson amount of keys,
+     * and a missing key passes a block of i keys with the rate of a plain Bloom filter of one
+     * block and i keys
+     * @param bitsPerKey Bits of the filter per key
+     * @param hashes Amount of bits per key
+     * @return Expected false positive rate
+     */
+    static double _expectedRate (double bitsPerKey , int hashes)
+    {
+        double mean = BLOOM_BLOCK_BITS / bitsPerKey;
+        double unset = std::log1p (- 1.0 / BLOOM_BLOCK_BITS) * hashes;
+        double chance = std::exp (- mean);
+        double rate = 0;
+        int last = (int) (mean + 10 * std::sqrt (mean) + 10);
+        for (int keys = 0 ; keys <= last ; ++ keys)
+        {
+            rate += chance * std::pow (1 - std::exp (unset * keys) , hashes);
+            chance *= mean / (keys + 1);
+        }
+        return rate;
+    }
+};
+
+#endif //CPPEX3_BLOOMFILTER_HPP
@@ -0,0 +1,98 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_BOUNDEDQUEUE_HPP
+#define CPPEX3_BOUNDEDQUEUE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+template<typename T>
+/**
+ * Blocking FIFO queue of bounded capacity shared by producers and consumers
+ * @tparam T type of the items
+ */
+class BoundedQueue
+{
+public:
+    /**
+     * Constructor
+     * @param capacity Maximal amount of items waiting in the queue
+     */
+    explicit BoundedQueue (size_t capacity) : _capacity (capacity) , closed (false)
+    {
+    }
+
+    /**
+     * Pushes an item, blocks while the queue is full
+     * @param item Item to push
+     */
+    void push (T item)
+    {
+        std::unique_lock<std::mutex> lock (mutex);
+        notFull.wait (lock , [this] ()
+        { return items.size () < _capacity; });
+        items.push_back (std::move (item));
+        notEmpty.notify_one ();
+    }
+
+    /**
+     * Pops the oldest item, blocks while the queue is empty and not closed
+     * @param item Filled with the popped item
+     * @return true if an item was popped, false if the queue is closed and drained
+     */
+    bool pop (T & item)
+    {
+        std::unique_lock<std::mutex> lock (mutex);
+        notEmpty.wait (lock , [this] ()
+        { return ! items.empty () || closed; });
+        if (items.empty ())
+        {
+            return false;
+        }
+        item = std::move (items.front ());
+        items.pop_front ();
+        notFull.notify_one ();
+        return true;
+    }
+
+    /**
+     * Closes the queue, consumers drain the remaining items and then stop
+     */
+    void close ()
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        closed = true;
+        notEmpty.notify_all ();
+    }
+
+private:
+    /**
+     * maximal amount of waiting items
+     */
+    size_t _capacity;
+    /**
+     * true once no more items will be pushed
+     */
+    bool closed;
+    /**
+     * waiting items
+     */
+    std::deque<T> items;
+    /**
+     * guards all the members
+     */
+    std::mutex mutex;
+    /**
+     * signaled when an item is popped
+     */
+    std::condition_variable notFull;
+    /**
+     * signaled when an item is pushed or the queue is closed
+     */
+    std::condition_variable notEmpty;
+};
+
+#endif //CPPEX3_BOUNDEDQUEUE_HPP
@@ -0,0 +1,517 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_BYTEKERNELS_HPP
+#define CPPEX3_BYTEKERNELS_HPP
+//---------------DEFINES--------------
+#define KERNEL_SCALAR 0
+
+#define KERNEL_SSE2 1
+
+#define KERNEL_AVX2 2
+
+#define KERNEL_AVX512 3
+
+#define SSE2_NEEDLES 8
+
+#define BYTE_VALUES 256
+
+#define ALL_LANES ((__mmask16) 0xffff)
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * Set of byte values, with the tables every kernel level needs to look for its members.
+ */
+struct ByteSet
+{
+    /**
+     * true for every member
+     */
+    bool member[BYTE_VALUES];
+    /**
+     * shufti tables: a byte may be a member only if the entries of its low and high nibble
+     * share a bit, exact while the members use at most 8 distinct high nibbles
+     */
+    unsigned char lo[16];
+    unsigned char hi[16];
+    /**
+     * the members themselves, if there are at most SSE2_NEEDLES of them
+     */
+    unsigned char needles[SSE2_NEEDLES];
+    /**
+     * amount of members
+     */
+    int count;
+};
+
+/**
+ * Byte scanning kernels, vectorized for SSE2, AVX2 and AVX-512BW and picked at run time by what
+ * the CPU supports, with a scalar version that every vector version must agree with.
+ * The vector code is compiled with target attributes, so the binary still runs on any x86-64
+ * and nothing but the CPU decides which level is used.
+ */
+class ByteKernels
+{
+public:
+    /**
+     * Level used by the kernels
+     * @return One of the KERNEL_ levels
+     */
+    static int level ()
+    {
+        return _level ();
+    }
+
+    /**
+     * Highest level the CPU supports
+     * @return One of the KERNEL_ levels
+     */
+    static int supported ()
+    {
+#ifdef KERNELS_X86
+        __builtin_cpu_init ();
+        if (__builtin_cpu_supports ("avx512bw"))
+        {
+            return KERNEL_AVX512;
+        }
+        if (__builtin_cpu_supports ("avx2"))
+        {
+            return KERNEL_AVX2;
+        }
+        return KERNEL_SSE2;
+#else
+        return KERNEL_SCALAR;
+#endif
+    }
+
+    /**
+     * Lowers the level used by the kernels, e.g. to compare them
+     * @param wanted Wanted level, capped at the supported one
+     */
+    static void setLevel (int wanted)
+    {
+        int top = supported ();
+        _level () = wanted < top ? wanted : top;
+    }
+
+    /**
+     * Builds the tables of a set of bytes
+     * @param member true for every member, BYTE_VALUES entries
+     * @return The set
+     */
+    static ByteSet makeSet (const bool *member)
+    {
+        ByteSet set {};
+        int bitOf[16];
+        int distinct = 0;
+        for (int h = 0 ; h < 16 ; ++ h)
+        {
+            bitOf[h] = - 1;
+        }
+        for (int b = 0 ; b < BYTE_VALUES ; ++ b)
+        {
+            if (! member[b])
+            {
+                continue;
+            }
+            set.member[b] = true;
+            if (set.count < SSE2_NEEDLES)
+            {
+                set.needles[set.count] = (unsigned char) b;
+            }
+            ++ set.count;
+            int h = b >> 4;
+            if (bitOf[h] == - 1)
+            {
+                // past 8 high nibbles some share a bit, the members are then verified
+                bitOf[h] = distinct ++ % 8;
+            }
+            set.lo[b & 15] |= (unsigned char) (1 << bitOf[h]);
+            set.hi[h] |= (unsigned char) (1 << bitOf[h]);
+        }
+        return set;
+    }
+
+    /**
+     * Lowers the ASCII upper case letters in place, every other byte is left as is
+     * @param text Text to lower
+     * @param length Length of the text
+     */
+    static void lowerAll (char *text , size_t length)
+    {
+        size_t i = 0;
+#ifdef KERNELS_X86
+        switch (_level ())
+        {
+            case KERNEL_AVX512:
+                i = _lowerAvx512 (text , length);
+                break;
+            case KERNEL_AVX2:
+                i = _lowerAvx2 (text , length);
+                break;
+            case KERNEL_SSE2:
+                i = _lowerSse2 (text , length);
+                break;
+            default:
+                break;
+        }
+#endif
+        for ( ; i < length ; ++ i)
+        {
+            text[i] = _lower (text[i]);
+        }
+    }
+
+    /**
+     * Finds the first byte of the text that is in the set
+     * @param text Text to scan
+     * @param length Length of the text
+     * @param set Set to look for
+     * @return Index of the byte, length if none
+     */
+    static size_t findAny (const char *text , size_t length , const ByteSet & set)
+    {
+        return findPair (text , length , set , nullptr);
+    }
+
+    /**
+     * Finds the first position where a byte of the first set is followed by a byte of the
+     * second, the last byte of the text only has to be in the first set since its follower is
+     * not known yet
+     * @param text Text to scan
+     * @param length Length of the text
+     * @param first Set of the first byte
+     * @param second Set of the second byte, nullptr to accept any
+     * @return Index of the first byte, length if none
+     */
+    static size_t findPair (const char *text , size_t length , const ByteSet & first ,
+                            const ByteSet *second)
+    {
+        size_t i = 0;
+#ifdef KERNELS_X86
+        switch (_level ())
+        {
+            case KERNEL_AVX512:
+                i = _findAvx512 (text , length , first , second);
+                break;
+            case KERNEL_AVX2:
+                i = _findAvx2 (text , length , first , second);
+                break;
+            case KERNEL_SSE2:
+                if (first.count <= SSE2_NEEDLES && (second == nullptr ||
+                                                     second->count <= SSE2_NEEDLES))
+                {
+                    i = _findSse2 (text , length , first , second);
+                }
+                break;
+            default:
+                break;
+        }
+#endif
+        for ( ; i < length ; ++ i)
+        {
+            if (_at (text , length , i , first , second))
+            {
+                return i;
+            }
+        }
+        return length;
+    }
+
+private:
+    /**
+     * Level used by the kernels, the supported one unless lowered
+     * @return Reference to the level
+     */
+    static int & _level ()
+    {
+        static int current = supported ();
+        return current;
+    }
+
+    /**
+     * Lowers one ASCII upper case letter
+     * @param c Byte to lower
+     * @return The lowered byte
+     */
+    static char _lower (char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? (char) (c - 'A' + 'a') : c;
+    }
+
+    /**
+     * Checks one position of findPair
+     * @param text Text to scan
+     * @param length Length of the text
+     * @param i Position to check
+     * @param first Set of the first byte
+     * @param second Set of the second byte, nullptr to accept any
+     * @return true if the position matches false otherwise
+     */
+    static bool _at (const char *text , size_t length , size_t i , const ByteSet & first ,
+                     const ByteSet *second)
+    {
+        return first.member[(unsigned char) text[i]] &&
+               (second == nullptr || i + 1 == length ||
+                second->member[(unsigned char) text[i + 1]]);
+    }
+
+    /**
+     * Verifies the candidate positions of a block, the vector filters may let through bytes
+     * that only share a shufti bit with a member
+     * @param text Text to scan
+     * @param length Length of the text
+     * @param start Position of the block
+     * @param candidates Candidate bit per position of the block
+     * @param first Set of the first byte
+     * @param second Set of the second byte, nullptr to accept any
+     * @param found Set to the first verified position
+     * @return true if a position was verified false otherwise
+     */
+    static bool _verify (const char *text , size_t length , size_t start , uint64_t candidates ,
+                         const ByteSet & first , const ByteSet *second , size_t & found)
+    {
+        while (candidates != 0)
+        {
+            size_t i = start + (size_t) __builtin_ctzll (candidates);
+            if (_at (text , length , i , first , second))
+            {
+                found = i;
+                return true;
+            }
+            candidates &= candidates - 1;
+        }
+        return false;
+    }
+
+#ifdef KERNELS_X86
+
+    /**
+     * SSE2 lowering of whole 16 byte blocks
+     * @param text Text to lower
+     * @param length Length of the text
+     * @return Amount of bytes lowered
+     */
+    static size_t _lowerSse2 (char *text , size_t length)
+    {
+        // shifting by 128 - 'A' moves 'A'..'Z' to the bottom of the signed range
+        const __m128i shift = _mm_set1_epi8 ((char) (0x80 - 'A'));
+        const __m128i bound = _mm_set1_epi8 ((char) (0x80 + 26));
+        const __m128i bit = _mm_set1_epi8 (0x20);
+        size_t i = 0;
+        for ( ; i + 16 <= length ; i += 16)
+        {
+            __m128i v = _mm_loadu_si128 ((const __m128i *) (text + i));
+            __m128i upper = _mm_cmplt_epi8 (_mm_add_epi8 (v , shift) , bound);
+            _mm_storeu_si128 ((__m128i *) (text + i) ,
+                              _mm_or_si128 (v , _mm_and_si128 (upper , bit)));
+        }
+        return i;
+    }
+
+    /**
+     * AVX2 lowering of whole 32 byte blocks
+     * @param text Text to lower
+     * @param length Length of the text
+     * @return Amount of bytes lowered
+     */
+    __attribute__ ((target ("avx2")))
+    static size_t _lowerAvx2 (char *text , size_t length)
+    {
+        const __m256i shift = _mm256_set1_epi8 ((char) (0x80 - 'A'));
+        const __m256i bound = _mm256_set1_epi8 ((char) (0x80 + 26));
+        const __m256i bit = _mm256_set1_epi8 (0x20);
+        size_t i = 0;
+        for ( ; i + 32 <= length ; i += 32)
+        {
+            __m256i v = _mm256_loadu_si256 ((const __m256i *) (text + i));
+            __m256i upper = _mm256_cmpgt_epi8 (bound , _mm256_add_epi8 (v , shift));
+            _mm256_storeu_si256 ((__m256i *) (text + i) ,
+                                 _mm256_or_si256 (v , _mm256_and_si256 (upper , bit)));
+        }
+        return i;
+    }
+
+    /**
+     * AVX-512BW lowering of whole 64 byte blocks
+     * @param text Text to lower
+     * @param length Length of the text
+     * @return Amount of bytes lowered
+     */
+    __attribute__ ((target ("avx512bw")))
+    static size_t _lowerAvx512 (char *text , size_t length)
+    {
+        const __m512i a = _mm512_set1_epi8 ('A');
+        const __m512i letters = _mm512_set1_epi8 (26);
+        const __m512i bit = _mm512_set1_epi8 (0x20);
+        size_t i = 0;
+        for ( ; i + 64 <= length ; i += 64)
+        {
+            __m512i v = _mm512_loadu_si512 ((const void *) (text + i));
+            __mmask64 upper = _mm512_cmplt_epu8_mask (_mm512_sub_epi8 (v , a) , letters);
+            _mm512_storeu_si512 ((void *) (text + i) , _mm512_mask_add_epi8 (v , upper , v , bit));
+        }
+        return i;
+    }
+
+    /**
+     * SSE2 membership of 16 bytes, by comparing with every member
+     * @param v Bytes to check
+     * @param set Set of at most SSE2_NEEDLES members
+     * @return Bit per member byte
+     */
+    static uint64_t _maskSse2 (__m128i v , const ByteSet & set)
+    {
+        __m128i hits = _mm_setzero_si128 ();
+        for (int n = 0 ; n < set.count ; ++ n)
+        {
+            hits = _mm_or_si128 (hits ,
+                                 _mm_cmpeq_epi8 (v , _mm_set1_epi8 ((char) set.needles[n])));
+        }
+        return (uint64_t) (unsigned) _mm_movemask_epi8 (hits);
+    }
+
+    /**
+     * SSE2 findPair over whole blocks, for sets of at most SSE2_NEEDLES members
+     * @param text Text to scan
+     * @param length Length of the text
+     * @param first Set of the first byte
+     * @param second Set of the second byte, nullptr to accept any
+     * @return Index of the first match, or where the scalar tail starts
+     */
+    static size_t _findSse2 (const char *text , size_t length , const ByteSet & first ,
+                             const ByteSet *second)
+    {
+        size_t i = 0;
+        size_t found;
+        for ( ; i + 17 <= length ; i += 16)
+        {
+            uint64_t candidates = _maskSse2 (_mm_loadu_si128 ((const __m128i *) (text + i)) ,
+                                             first);
+            if (candidates != 0 && second != nullptr)
+            {
+                candidates &= _maskSse2 (_mm_loadu_si128 ((const __m128i *) (text + i + 1)) ,
+                                         *second);
+            }
+            if (_verify (text , length , i , candidates , first , second , found))
+            {
+                return found;
+            }
+        }
+        return i;
+    }
+
+    /**
+     * AVX2 shufti membership of 32 bytes
+     * @param v Bytes to check
+     * @param set Set to check against
+     * @return Bit per byte that may be a member
+     */
+    __attribute__ ((target ("avx2")))
+    static uint64_t _maskAvx2 (__m256i v , const ByteSet & set)
+    {
+        const __m256i nibble = _mm256_set1_epi8 (0x0f);
+        __m256i lo = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) set.lo));
+        __m256i hi = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) set.hi));
+        __m256i low = _mm256_shuffle_epi8 (lo , _mm256_and_si256 (v , nibble));
+        __m256i high = _mm256_shuffle_epi8 (hi , _mm256_and_si256 (_mm256_srli_epi16 (v , 4) ,
+                                                                   nibble));
+        __m256i none = _mm256_cmpeq_epi8 (_mm256_and_si256 (low , high) , _mm256_setzero_si256 ());
+        return (uint64_t) (uint32_t) ~_mm256_movemask_epi8 (none);
+    }
+
+    /**
+     * AVX2 findPair over whole blocks
+     * @param text Text to scan
+     * @param length Length of the text
+     * @param first Set of the first byte
+     * @param second Set of the second byte, nullptr to accept any
+     * @return Index of the first match, or where the scalar tail starts
+     */
+    __attribute__ ((target ("avx2")))
+    static size_t _findAvx2 (const char *text , size_t length , const ByteSet & first ,
+                             const ByteSet *second)
+    {
+        size_t i = 0;
+        size_t found;
+        for ( ; i + 33 <= length ; i += 32)
+        {
+            uint64_t candidates = _maskAvx2 (_mm256_loadu_si256 ((const __m256i *) (text + i)) ,
+                                             first);
+            if (candidates != 0 && second != nullptr)
+            {
+                candidates &= _maskAvx2 (_mm256_loadu_si256 ((const __m256i *) (text + i + 1)) ,
+                                         *second);
+            }
+            if (_verify (text , length , i , candidates , first , second , found))
+            {
+                return found;
+            }
+        }
+        return i;
+    }
+
+    /**
+     * AVX-512BW shufti membership of 64 bytes
+     * @param v Bytes to check
+     * @param set Set to check against
+     * @return Bit per byte that may be a member
+     */
+    __attribute__ ((target ("avx512bw")))
+    static uint64_t _maskAvx512 (__m512i v , const ByteSet & set)
+    {
+        const __m512i nibble = _mm512_set1_epi8 (0x0f);
+        __m512i lo = _mm512_maskz_broadcast_i32x4 (ALL_LANES ,
+                                                   _mm_loadu_si128 ((const __m128i *) set.lo));
+        __m512i hi = _mm512_maskz_broadcast_i32x4 (ALL_LANES ,
+                                                   _mm_loadu_si128 ((const __m128i *) set.hi));
+        __m512i low = _mm512_shuffle_epi8 (lo , _mm512_and_si512 (v , nibble));
+        __m512i high = _mm512_shuffle_epi8 (hi , _mm512_and_si512 (_mm512_srli_epi16 (v , 4) ,
+                                                                   nibble));
+        return (uint64_t) _mm512_test_epi8_mask (low , high);
+    }
+
+    /**
+     * AVX-512BW findPair over whole blocks
+     * @param text Text to scan
+     * @param length Length of the text
+     * @param first Set of the first byte
+     * @param second Set of the second byte, nullptr to accept any
+     * @return Index of the first match, or where the scalar tail starts
+     */
+    __attribute__ ((target ("avx512bw")))
+    static size_t _findAvx512 (const char *text , size_t length , const ByteSet & first ,
+                               const ByteSet *second)
+    {
+        size_t i = 0;
+        size_t found;
+        for ( ; i + 65 <= length ; i += 64)
+        {
+            uint64_t candidates = _maskAvx512 (_mm512_loadu_si512 ((const void *) (text + i)) ,
+                                               first);
+            if (candidates != 0 && second != nullptr)
+            {
+                candidates &= _maskAvx512 (_mm512_loadu_si512 ((const void *) (text + i + 1)) ,
+                                           *second);
+            }
+            if (_verify (text , length , i , candidates , first , second , found))
+            {
+                return found;
+            }
+        }
+        return i;
+    }
+
+#endif
+};
+
+#endif //CPPEX3_BYTEKERNELS_HPP
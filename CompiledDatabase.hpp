@@ -0,0 +1,357 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_COMPILEDDATABASE_HPP
+#define CPPEX3_COMPILEDDATABASE_HPP
+//---------------DEFINES--------------
+#define COMPILED_MAGIC "SPAMDB\x1a\n"
+
+#define MAGIC_SIZE 8
+
+#define COMPILED_VERSION 1
+
+#define CHECKSUM_OFFSET 14695981039346656037ULL
+
+#define CHECKSUM_PRIME 1099511628211ULL
+
+#define SOURCE_PER_LINE 16
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include "AhoCorasick.hpp"
+#include "HashMap.hpp"
+#include "MappedFile.hpp"
+
+/**
+ * Header of a compiled database file.
+ * The header is followed, in native byte order, by:
+ *  uint64_t keyOffsets[entries + 1]     start of every key in keys, the last one is keyBytes
+ *  unsigned char classOf[ALPHABET_SIZE] byte classes of the matcher
+ *  int32_t delta[states * classes]      transitions of the matcher
+ *  int32_t out[states]                  weights of the matcher states
+ *  int32_t scores[entries]              score of every key
+ *  char keys[keyBytes]                  lowered keys, back to back
+ * checksum covers everything after the header.
+ */
+struct CompiledHeader
+{
+    char magic[MAGIC_SIZE];
+    uint32_t version;
+    uint32_t classes;
+    uint32_t states;
+    uint32_t entries;
+    uint64_t keyBytes;
+    uint64_t checksum;
+};
+
+/**
+ * Database compiled by "SpamDetector --compile", the table and the matcher are used directly
+ * from the mapped file without parsing or per entry allocation.
+ */
+class CompiledDatabase
+{
+public:
+    /**
+     * Def const, nothing opened
+     */
+    CompiledDatabase () : header (nullptr) , keyOffsets (nullptr) , classOf (nullptr) ,
+                          delta (nullptr) , out (nullptr) , scores (nullptr) , keys (nullptr)
+    {
+    }
+
+    /**
+     * Checks if the file starts like a compiled database
+     * @param path Path of the file
+     * @return true if compiled false otherwise
+     */
+    static bool isCompiled (const std::string & path)
+    {
+        std::ifstream in (path , std::ios::binary);
+        char magic[MAGIC_SIZE] = {};
+        in.read (magic , MAGIC_SIZE);
+        return in && std::memcmp (magic , COMPILED_MAGIC , MAGIC_SIZE) == 0;
+    }
+
+    /**
+     * Writes the table and the matcher compiled from it
+     * @param path Path of the file to write
+     * @param table Lowered and validated database
+     * @param matcher Matcher compiled from the table
+     * @return true if the file could not be written false otherwise
+     */
+    static bool write (const std::string & path , const PatternTable & table ,
+                       const AhoCorasick & matcher)
+    {
+        std::string payload;
+        std::string keyBytes;
+        std::vector<uint64_t> offsets;
+        std::vector<int32_t> weights;
+        for (const auto & i : table)
+        {
+            offsets.push_back (keyBytes.size ());
+            weights.push_back (i.second);
+            keyBytes += i.first;
+        }
+        offsets.push_back (keyBytes.size ());
+        _append (payload , offsets.data () , offsets.size () * sizeof (uint64_t));
+        _append (payload , matcher.classTable () , ALPHABET_SIZE);
+        _append (payload , matcher.transitions () ,
+                 (size_t) matcher.states () * matcher.classes () * sizeof (int32_t));
+        _append (payload , matcher.weights () , (size_t) matcher.states () * sizeof (int32_t));
+        _append (payload , weights.data () , weights.size () * sizeof (int32_t));
+        payload += keyBytes;
+        CompiledHeader head {};
+        std::memcpy (head.magic , COMPILED_MAGIC , MAGIC_SIZE);
+        head.version = COMPILED_VERSION;
+        head.classes = (uint32_t) matcher.classes ();
+        head.states = (uint32_t) matcher.states ();
+        head.entries = (uint32_t) weights.size ();
+        head.keyBytes = keyBytes.size ();
+        head.checksum = _checksum (payload.data () , payload.size ());
+        std::ofstream file (path , std::ios::binary | std::ios::trunc);
+        file.write ((const char *) &head , sizeof (head));
+        file.write (payload.data () , (std::streamsize) payload.size ());
+        file.close ();
+        return ! file;
+    }
+
+    /**
+     * Writes the matcher compiled from the table as a C++ header of constexpr arrays, so a
+     * fixed database can be built into the binary (see SPAM_EMBEDDED_DB in SpamDetector.cpp)
+     * and used without reading or allocating anything.
+     * @param path Path of the header to write
+     * @param table Lowered and validated database
+     * @param matcher Matcher compiled from the table
+     * @return true if the file could not be written false otherwise
+     */
+    static bool writeSource (const std::string & path , const PatternTable & table ,
+                             const AhoCorasick & matcher)
+    {
+        std::string source;
+        source += "// Generated by SpamDetector --emit-cpp, do not edit.\n";
+        source += "// " + std::to_string (table.size ()) + " patterns, " +
+                  std::to_string (matcher.states ()) + " states, " +
+                  std::to_string (matcher.classes ()) + " byte classes.\n\n";
+        source += "#ifndef SPAM_EMBEDDED_DATABASE_HPP\n#define SPAM_EMBEDDED_DATABASE_HPP\n\n";
+        source += "#include <cstdint>\n\n";
+        source += "/**\n * Matcher of the embedded database, in the layout of AhoCorasick\n */\n";
+        source += "struct EmbeddedDatabase\n{\n";
+        source += "    static constexpr int classes = " + std::to_string (matcher.classes ()) + ";\n";
+        source += "    static constexpr int states = " + std::to_string (matcher.states ()) + ";\n";
+        _appendArray (source , "unsigned char" , "classOf" , matcher.classTable () , ALPHABET_SIZE);
+        _appendArray (source , "int32_t" , "delta" , matcher.transitions () ,
+                      (size_t) matcher.states () * matcher.classes ());
+        _appendArray (source , "int32_t" , "out" , matcher.weights () , (size_t) matcher.states ());
+        source += "};\n\n#endif //SPAM_EMBEDDED_DATABASE_HPP\n";
+        std::ofstream file (path , std::ios::trunc);
+        file.write (source.data () , (std::streamsize) source.size ());
+        file.close ();
+        return ! file;
+    }
+
+    /**
+     * Maps and validates a compiled database
+     * @param path Path of the file
+     * @return true if invalid false otherwise
+     */
+    bool open (const std::string & path)
+    {
+        header = nullptr;
+        if (file.open (path) || file.size () < sizeof (CompiledHeader))
+        {
+            return true;
+        }
+        const auto *head = (const CompiledHeader *) file.data ();
+        if (std::memcmp (head->magic , COMPILED_MAGIC , MAGIC_SIZE) != 0 ||
+            head->version != COMPILED_VERSION || head->classes == 0 ||
+            head->classes > ALPHABET_SIZE || head->states == 0)
+        {
+            return true;
+        }
+        uint64_t cells = (uint64_t) head->states * head->classes;
+        // every section is taken from what is left of the file, so a huge length in a damaged
+        // header can not wrap the sum around to the size of the file
+        uint64_t left = file.size () - sizeof (CompiledHeader);
+        if (_take (left , (head->entries + 1ULL) * sizeof (uint64_t)) ||
+            _take (left , ALPHABET_SIZE) || _take (left , cells * sizeof (int32_t)) ||
+            _take (left , (uint64_t) head->states * sizeof (int32_t)) ||
+            _take (left , (uint64_t) head->entries * sizeof (int32_t)) ||
+            _take (left , head->keyBytes) || left != 0)
+        {
+            return true;
+        }
+        const char *payload = file.data () + sizeof (CompiledHeader);
+        if (_checksum (payload , file.size () - sizeof (CompiledHeader)) != head->checksum)
+        {
+            return true;
+        }
+        keyOffsets = (const uint64_t *) payload;
+        classOf = (const unsigned char *) (keyOffsets + head->entries + 1);
+        delta = (const int32_t *) (classOf + ALPHABET_SIZE);
+        out = delta + cells;
+        scores = out + head->states;
+        keys = (const char *) (scores + head->entries);
+        if (_invalidContent (*head , cells))
+        {
+            return true;
+        }
+        header = head;
+        return false;
+    }
+
+    /**
+     * Matcher stored in the file, valid while the database is open
+     * @return View over the stored matcher
+     */
+    AhoCorasick matcher () const
+    {
+        return AhoCorasick ((int) header->classes , (int) header->states , classOf , delta , out);
+    }
+
+    /**
+     * Fills the table with the stored keys and scores
+     * @param table Table to fill
+     */
+    void fill (PatternTable & table) const
+    {
+        table.reserve ((int) (table.size () + header->entries));
+        for (uint32_t i = 0 ; i < header->entries ; ++ i)
+        {
+            table.insert (std::string_view (keys + keyOffsets[i] ,
+                                           keyOffsets[i + 1] - keyOffsets[i]) , scores[i]);
+        }
+    }
+
+private:
+    /**
+     * the mapped file
+     */
+    MappedFile file;
+    /**
+     * views into the mapped file, header is nullptr until a valid file is opened
+     */
+    const CompiledHeader *header;
+    const uint64_t *keyOffsets;
+    const unsigned char *classOf;
+    const int32_t *delta;
+    const int32_t *out;
+    const int32_t *scores;
+    const char *keys;
+
+    /**
+     * Checks that every offset, class and transition stays in its array, so a damaged file
+     * that still passes the checksum can not make the matcher read out of bounds.
+     * @param head Header of the file
+     * @param cells Amount of transitions
+     * @return true if invalid false otherwise
+     */
+    bool _invalidContent (const CompiledHeader & head , uint64_t cells) const
+    {
+        for (uint32_t i = 0 ; i < head.entries ; ++ i)
+        {
+            if (keyOffsets[i] > keyOffsets[i + 1])
+            {
+                return true;
+            }
+        }
+        if (keyOffsets[0] != 0 || keyOffsets[head.entries] != head.keyBytes)
+        {
+            return true;
+        }
+        for (int c = 0 ; c < ALPHABET_SIZE ; ++ c)
+        {
+            if (classOf[c] >= head.classes)
+            {
+                return true;
+            }
+        }
+        for (uint64_t i = 0 ; i < cells ; ++ i)
+        {
+            if (delta[i] < 0 || (uint32_t) delta[i] >= head.states)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Takes a section from the bytes left in the file
+     * @param left Bytes left, lowered by the length of the section
+     * @param length Length of the section
+     * @return true if invalid false otherwise
+     */
+    static bool _take (uint64_t & left , uint64_t length)
+    {
+        if (length > left)
+        {
+            return true;
+        }
+        left -= length;
+        return false;
+    }
+
+    /**
+     * Appends raw bytes to the payload
+     * @param payload Payload to append to
+     * @param data Bytes to append
+     * @param size Amount of bytes
+     */
+    static void _append (std::string & payload , const void *data , size_t size)
+    {
+        payload.append ((const char *) data , size);
+    }
+
+    /**
+     * Appends the definition of a constexpr array member to a generated header
+     * @tparam T type of the elements
+     * @param source Header to append to
+     * @param type Name of the element type in the header
+     * @param name Name of the array
+     * @param data Elements of the array
+     * @param size Amount of elements, at least one
+     */
+    template<typename T>
+    static void _appendArray (std::string & source , const char *type , const char *name ,
+                              const T *data , size_t size)
+    {
+        source += std::string ("    static constexpr ") + type + " " + name + "[" +
+                  std::to_string (size) + "] = {";
+        for (size_t i = 0 ; i < size ; ++ i)
+        {
+            source += i % SOURCE_PER_LINE == 0 ? "\n            " : " ";
+            source += std::to_string ((long long) data[i]);
+            source += i + 1 < size ? "," : "";
+        }
+        source += "\n    };\n";
+    }
+
+    /**
+     * FNV-1a over 64 bit words, the tail is folded in byte by byte
+     * @param data Bytes to hash
+     * @param size Amount of bytes
+     * @return Checksum of the bytes
+     */
+    static uint64_t _checksum (const char *data , size_t size)
+    {
+        uint64_t hash = CHECKSUM_OFFSET;
+        size_t i = 0;
+        for ( ; i + sizeof (uint64_t) <= size ; i += sizeof (uint64_t))
+        {
+            uint64_t word;
+            std::memcpy (&word , data + i , sizeof (word));
+            hash = (hash ^ word) * CHECKSUM_PRIME;
+        }
+        for ( ; i < size ; ++ i)
+        {
+            hash = (hash ^ (unsigned char) data[i]) * CHECKSUM_PRIME;
+        }
+        return hash;
+    }
+};
+
+#endif //CPPEX3_COMPILEDDATABASE_HPP
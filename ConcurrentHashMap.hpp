@@ -0,0 +1,759 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_CONCURRENTHASHMAP_HPP
+#define CPPEX3_CONCURRENTHASHMAP_HPP
+//---------------DEFINES--------------
+#define CONCURRENT_SHARDS 64
+
+#define CACHE_LINE 64
+
+#define EPOCH_READERS 128
+
+#define RETIRE_BATCH 64
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "HashMap.hpp"
+
+/**
+ * Epoch based reclamation shared by every ConcurrentHashMap of the process. A reader pins the
+ * current epoch in a record of its own for as long as it walks the nodes of a map, a writer tags
+ * what it unlinks with the epoch of the moment and frees it once the epoch moved on twice: the
+ * epoch only moves on when every pinned reader is in the current one, so by then no reader that
+ * could have seen the unlinked object is left.
+ * A thread takes a record on its first read and gives it back when it ends, a thread that finds
+ * every record taken reads under the lock of the shard instead.
+ */
+class EpochDomain
+{
+    struct Local;
+
+public:
+    /**
+     * Pins the epoch for the lifetime of the object, pins of one thread nest
+     */
+    class Pin
+    {
+    public:
+        /**
+         * Def const
+         */
+        Pin () : local (_local ())
+        {
+            if (local.record != nullptr && local.depth ++ == 0)
+            {
+                local.record->pinned.store (epoch.load (std::memory_order_relaxed) ,
+                                            std::memory_order_release);
+                // the pin is visible before any node is read, see advance
+                std::atomic_thread_fence (std::memory_order_seq_cst);
+            }
+        }
+
+        Pin (const Pin & other) = delete;
+
+        Pin & operator= (const Pin & other) = delete;
+
+        /**
+         * Dest
+         */
+        ~Pin ()
+        {
+            if (local.record != nullptr && -- local.depth == 0)
+            {
+                local.record->pinned.store (0 , std::memory_order_release);
+            }
+        }
+
+        /**
+         * Checks if the thread has a record, without one the read must lock
+         * @return true if pinned false otherwise
+         */
+        bool pinned () const
+        {
+            return local.record != nullptr;
+        }
+
+    private:
+        /**
+         * the record of the thread
+         */
+        Local & local;
+    };
+
+    /**
+     * Epoch a writer tags what it unlinked with, read after the unlink
+     * @return The current epoch
+     */
+    static uint64_t now ()
+    {
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        return epoch.load (std::memory_order_relaxed);
+    }
+
+    /**
+     * Moves the epoch on if every pinned reader is in the current one
+     * @return The epoch after the attempt
+     */
+    static uint64_t advance ()
+    {
+        uint64_t current = epoch.load (std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        for (const Record & record : records)
+        {
+            uint64_t pinned = record.pinned.load (std::memory_order_acquire);
+            if (pinned != 0 && pinned != current)
+            {
+                return current;
+            }
+        }
+        epoch.compare_exchange_strong (current , current + 1);
+        return epoch.load (std::memory_order_relaxed);
+    }
+
+private:
+    /**
+     * The pinned epoch of one thread, 0 while it reads nothing, on a cache line of its own
+     */
+    struct alignas (CACHE_LINE) Record
+    {
+        std::atomic<uint64_t> pinned {0};
+        std::atomic<bool> owned {false};
+    };
+
+    /**
+     * The record of a thread and how deep its pins nest, the record is given back when the
+     * thread ends
+     */
+    struct Local
+    {
+        Record *record = nullptr;
+        bool claimed = false;
+        int depth = 0;
+
+        ~Local ()
+        {
+            if (record != nullptr)
+            {
+                record->owned.store (false , std::memory_order_release);
+            }
+        }
+    };
+
+    /**
+     * the global epoch, starts at 1 since 0 marks a record that reads nothing
+     */
+    static std::atomic<uint64_t> epoch;
+    /**
+     * the records of the reading threads
+     */
+    static Record records[EPOCH_READERS];
+
+    /**
+     * The record of the calling thread, taken on the first call
+     * @return The local state of the thread
+     */
+    static Local & _local ()
+    {
+        thread_local Local local;
+        if (! local.claimed)
+        {
+            local.claimed = true;
+            for (Record & record : records)
+            {
+                bool owned = false;
+                if (record.owned.compare_exchange_strong (owned , true))
+                {
+                    local.record = &record;
+                    break;
+                }
+            }
+        }
+        return local;
+    }
+};
+
+inline std::atomic<uint64_t> EpochDomain::epoch {1};
+
+inline EpochDomain::Record EpochDomain::records[EPOCH_READERS];
+
+template<typename KeyT , typename ValueT , typename Hash = KeyHash<KeyT> ,
+        typename KeyEqual = std::equal_to<>>
+/**
+ * Hash map that many threads can read and write at once. The keys are split over a power of two
+ * amount of shards by the top bits of their (mixed) hash, every shard is a chained table whose
+ * nodes never change once published: an assign links a new node in place of the old one.
+ * Reads are optimistic and take no lock. They walk the chains through atomic pointers while the
+ * epoch is pinned (see EpochDomain), so no node or bucket array is freed under them. A hit is
+ * always valid, the node was in the map while it was read. A miss is checked against the
+ * seqlock of the shard, which is odd while a resize relinks its nodes, and retried if a resize
+ * ran meanwhile. Writers take the mutex of their shard, so they only wait for writers of the same
+ * shard and never for readers.
+ * Shards grow like a HashMap but never shrink, and every shard sits on its own cache lines, the
+ * read mostly words apart from the written ones.
+ * Nothing points into the map once a read returns, so lookups hand out copies of the values (or
+ * run a callback while the node is pinned) instead of iterators.
+ * @tparam KeyT type of Key
+ * @tparam ValueT type of Value
+ * @tparam Hash type of the hash of the keys
+ * @tparam KeyEqual type of the equality of the keys
+ */
+class ConcurrentHashMap
+{
+public:
+    /**
+     * Def const
+     * @param shards Amount of shards, rounded up to a power of two
+     */
+    explicit ConcurrentHashMap (int shards = CONCURRENT_SHARDS) : shift (64) , hasher () , equal ()
+    {
+        int amount = 1;
+        while (amount < shards)
+        {
+            amount *= 2;
+            -- shift;
+        }
+        _shards = amount;
+        table = std::unique_ptr<Shard[]> (new Shard[amount]);
+    }
+
+    ConcurrentHashMap (const ConcurrentHashMap & other) = delete;
+
+    ConcurrentHashMap & operator= (const ConcurrentHashMap & other) = delete;
+
+    /**
+     * Dest, no thread may use the map anymore
+     */
+    ~ConcurrentHashMap ()
+    {
+        for (int i = 0 ; i < _shards ; ++ i)
+        {
+            Buckets *buckets = table[i].buckets.load (std::memory_order_relaxed);
+            for (size_t j = 0 ; j <= buckets->mask ; ++ j)
+            {
+                _release (buckets->heads[j].load (std::memory_order_relaxed));
+            }
+            delete buckets;
+            for (const Retired & retired : table[i].retired)
+            {
+                delete retired.node;
+                delete retired.buckets;
+            }
+        }
+    }
+
+    /**
+     * Inserts the given key with value, or assigns the value if the key is already there
+     * @param key Key to insert
+     * @param value Value to insert
+     * @return true if inserted false otherwise
+     */
+    template<typename K = KeyT , typename V = ValueT>
+    bool insert (K && key , V && value)
+    {
+        uint64_t hash = _hashOf (key);
+        Shard & shard = _shardOf (hash);
+        std::lock_guard<std::mutex> lock (shard.mutex);
+        std::atomic<Node *> *link = _locate (shard , hash , key);
+        Node *node = new Node (hash , std::forward<K> (key) , std::forward<V> (value));
+        if (link == nullptr)
+        {
+            _link (shard , node);
+            return true;
+        }
+        Node *old = link->load (std::memory_order_relaxed);
+        node->next.store (old->next.load (std::memory_order_relaxed) , std::memory_order_relaxed);
+        link->store (node , std::memory_order_release);
+        _retire (shard , old , nullptr);
+        return false;
+    }
+
+    /**
+     * Inserts the key with a value constructed from the arguments, if the key is missing
+     * @param key Key to insert
+     * @param args Arguments for the value
+     * @return true if inserted false if already there
+     */
+    template<typename K = KeyT , typename... Args>
+    bool try_emplace (K && key , Args && ... args)
+    {
+        uint64_t hash = _hashOf (key);
+        Shard & shard = _shardOf (hash);
+        std::lock_guard<std::mutex> lock (shard.mutex);
+        if (_locate (shard , hash , key) != nullptr)
+        {
+            return false;
+        }
+        _link (shard , new Node (hash , std::forward<K> (key) , std::forward<Args> (args)...));
+        return true;
+    }
+
+    /**
+     * Erases the key given
+     * @param key Key to earse
+     * @return true if erased false otherwise
+     */
+    template<typename K = KeyT>
+    bool erase (const K & key)
+    {
+        uint64_t hash = _hashOf (key);
+        Shard & shard = _shardOf (hash);
+        std::lock_guard<std::mutex> lock (shard.mutex);
+        std::atomic<Node *> *link = _locate (shard , hash , key);
+        if (link == nullptr)
+        {
+            return false;
+        }
+        Node *old = link->load (std::memory_order_relaxed);
+        // readers standing on the old node still find the rest of the chain through it
+        link->store (old->next.load (std::memory_order_relaxed) , std::memory_order_release);
+        shard.size.store (shard.size.load (std::memory_order_relaxed) - 1 ,
+                          std::memory_order_relaxed);
+        _retire (shard , old , nullptr);
+        return true;
+    }
+
+    /**
+     * Copies out the value of the given key
+     * @param key Key to find
+     * @param value Set to the value of the key if found
+     * @return true if found false otherwise
+     */
+    template<typename K = KeyT>
+    bool find (const K & key , ValueT & value) const
+    {
+        return visit (key , [&value] (const ValueT & found) { value = found; });
+    }
+
+    /**
+     * Calls the callback once with the value of the key while its node is pinned, the callback
+     * must not write to the map
+     * @tparam F type of the callback
+     * @param key Key to find
+     * @param callback Called with a const reference to the value
+     * @return true if found false otherwise
+     */
+    template<typename K = KeyT , typename F>
+    bool visit (const K & key , F callback) const
+    {
+        uint64_t hash = _hashOf (key);
+        Shard & shard = _shardOf (hash);
+        EpochDomain::Pin pin;
+        if (! pin.pinned ())
+        {
+            std::lock_guard<std::mutex> lock (shard.mutex);
+            const Node *node = _search (shard.buckets.load (std::memory_order_relaxed) , hash , key);
+            if (node != nullptr)
+            {
+                callback (node->pair.second);
+            }
+            return node != nullptr;
+        }
+        while (true)
+        {
+            uint64_t version = shard.version.load (std::memory_order_acquire);
+            if ((version & 1) == 0)
+            {
+                const Node *node = _search (shard.buckets.load (std::memory_order_acquire) , hash ,
+                                            key);
+                if (node != nullptr)
+                {
+                    callback (node->pair.second);
+                    return true;
+                }
+                if (shard.version.load (std::memory_order_acquire) == version)
+                {
+                    return false;
+                }
+            }
+            // a resize relinks the nodes of the shard, the walk may have left its chain
+            std::this_thread::yield ();
+        }
+    }
+
+    /**
+     * Checks if the key given is in the map
+     * @param key Key to check
+     * @return true if contains false otherwise
+     */
+    template<typename K = KeyT>
+    bool containsKey (const K & key) const
+    {
+        return visit (key , [] (const ValueT &) {});
+    }
+
+    /**
+     * Calls the callback with every pair, one shard at a time under its mutex, so the pairs of a
+     * shard are seen as of one moment but not the whole map. Readers are not held up, writers of
+     * the visited shard are
+     * @tparam F type of the callback
+     * @param callback Called with every pair
+     */
+    template<typename F>
+    void forEach (F callback) const
+    {
+        for (int i = 0 ; i < _shards ; ++ i)
+        {
+            std::lock_guard<std::mutex> lock (table[i].mutex);
+            const Buckets *buckets = table[i].buckets.load (std::memory_order_relaxed);
+            for (size_t j = 0 ; j <= buckets->mask ; ++ j)
+            {
+                for (const Node *node = buckets->heads[j].load (std::memory_order_relaxed) ;
+                     node != nullptr ; node = node->next.load (std::memory_order_relaxed))
+                {
+                    callback (node->pair);
+                }
+            }
+        }
+    }
+
+    /**
+     * return the number of elements in the map, exact only while no thread writes
+     * @return number of elements in the map
+     */
+    int size () const
+    {
+        int total = 0;
+        for (int i = 0 ; i < _shards ; ++ i)
+        {
+            total += table[i].size.load (std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    /**
+     * check if the map is empty, exact only while no thread writes
+     * @return true if empty false otherwise
+     */
+    bool empty () const
+    {
+        return size () == 0;
+    }
+
+    /**
+     * Clears the map of items, one shard at a time, keeping the capacity of the shards
+     */
+    void clear ()
+    {
+        for (int i = 0 ; i < _shards ; ++ i)
+        {
+            Shard & shard = table[i];
+            std::lock_guard<std::mutex> lock (shard.mutex);
+            Buckets *buckets = shard.buckets.load (std::memory_order_relaxed);
+            for (size_t j = 0 ; j <= buckets->mask ; ++ j)
+            {
+                Node *node = buckets->heads[j].exchange (nullptr , std::memory_order_release);
+                while (node != nullptr)
+                {
+                    Node *next = node->next.load (std::memory_order_relaxed);
+                    _retire (shard , node , nullptr);
+                    node = next;
+                }
+            }
+            shard.size.store (0 , std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Prepares every shard for its part of the given amount of keys
+     * @param amount Amount of keys in the whole map
+     */
+    void reserve (int amount)
+    {
+        size_t capacity = INITIAL_CAPACITY;
+        while (capacity * UPPER_BOUND < amount / _shards + 1)
+        {
+            capacity *= CAPACITY_CHANGE;
+        }
+        for (int i = 0 ; i < _shards ; ++ i)
+        {
+            std::lock_guard<std::mutex> lock (table[i].mutex);
+            if (table[i].buckets.load (std::memory_order_relaxed)->mask + 1 < capacity)
+            {
+                _resize (table[i] , capacity);
+            }
+        }
+    }
+
+    /**
+     * Amount of shards
+     * @return Amount of shards
+     */
+    int shards () const
+    {
+        return _shards;
+    }
+
+private:
+    /**
+     * Type a key of type K is probed as, K itself if the hash and the equality are both
+     * transparent, KeyT otherwise
+     */
+    template<typename K>
+    using lookup_type = typename std::conditional<
+            isTransparent<Hash>::value && isTransparent<KeyEqual>::value , std::decay_t<K> ,
+            KeyT>::type;
+
+    /**
+     * A pair with its mixed hash, never changed once published but for the link to the next node
+     */
+    struct Node
+    {
+        template<typename K , typename... Args>
+        Node (uint64_t hash , K && key , Args && ... args) :
+                hash (hash) ,
+                pair (std::piecewise_construct , std::forward_as_tuple (std::forward<K> (key)) ,
+                      std::forward_as_tuple (std::forward<Args> (args)...)) ,
+                next (nullptr)
+        {
+        }
+
+        const uint64_t hash;
+        const std::pair<KeyT , ValueT> pair;
+        std::atomic<Node *> next;
+    };
+
+    /**
+     * The chain heads of a shard, a power of two of them
+     */
+    struct Buckets
+    {
+        explicit Buckets (size_t capacity) : mask (capacity - 1) ,
+                                             heads (new std::atomic<Node *>[capacity])
+        {
+            for (size_t i = 0 ; i < capacity ; ++ i)
+            {
+                heads[i].store (nullptr , std::memory_order_relaxed);
+            }
+        }
+
+        const size_t mask;
+        std::unique_ptr<std::atomic<Node *>[]> heads;
+    };
+
+    /**
+     * A node or bucket array unlinked by a writer, freed once the epoch moved on twice
+     */
+    struct Retired
+    {
+        uint64_t epoch;
+        Node *node;
+        Buckets *buckets;
+    };
+
+    /**
+     * A shard, the words its readers load on one cache line and the ones only its writers touch
+     * on the next
+     */
+    struct alignas (CACHE_LINE) Shard
+    {
+        Shard () : buckets (new Buckets (INITIAL_CAPACITY))
+        {
+        }
+
+        /**
+         * the seqlock, odd while a resize relinks the nodes
+         */
+        std::atomic<uint64_t> version {0};
+        std::atomic<Buckets *> buckets;
+        alignas (CACHE_LINE) mutable std::mutex mutex;
+        std::atomic<int> size {0};
+        std::vector<Retired> retired;
+    };
+
+    /**
+     * amount of shards
+     */
+    int _shards;
+    /**
+     * 64 - log2 of the amount of shards, the mixed hash is shifted by it to pick a shard
+     */
+    int shift;
+    /**
+     * the shards
+     */
+    std::unique_ptr<Shard[]> table;
+    /**
+     * hash of the keys
+     */
+    Hash hasher;
+    /**
+     * equality of the keys
+     */
+    KeyEqual equal;
+
+    /**
+     * Mixed hash of a key, its top bits pick the shard and its low bits the bucket, so the two do
+     * not correlate
+     * @param key Key to hash
+     * @return The mixed hash
+     */
+    template<typename K>
+    uint64_t _hashOf (const K & key) const
+    {
+        const lookup_type<K> & probe = key;
+        return mixHash ((uint64_t) hasher (probe));
+    }
+
+    /**
+     * Shard of a mixed hash
+     * @param hash Mixed hash of the key
+     * @return Shard of the key
+     */
+    Shard & _shardOf (uint64_t hash) const
+    {
+        return _shards == 1 ? table[0] : table[hash >> shift];
+    }
+
+    /**
+     * Walks the chain of a key, safe without the mutex while the epoch is pinned
+     * @param buckets Buckets of the shard
+     * @param hash Mixed hash of the key
+     * @param key Key to look for
+     * @return The node of the key, nullptr if not found
+     */
+    template<typename K>
+    const Node *_search (const Buckets *buckets , uint64_t hash , const K & key) const
+    {
+        const lookup_type<K> & probe = key;
+        for (const Node *node = buckets->heads[hash & buckets->mask].load (std::memory_order_acquire) ;
+             node != nullptr ; node = node->next.load (std::memory_order_acquire))
+        {
+            if (node->hash == hash && equal (node->pair.first , probe))
+            {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Finds the link that points to the node of a key, the mutex of the shard must be held
+     * @param shard Shard of the key
+     * @param hash Mixed hash of the key
+     * @param key Key to look for
+     * @return The link to the node of the key, nullptr if not found
+     */
+    template<typename K>
+    std::atomic<Node *> *_locate (Shard & shard , uint64_t hash , const K & key)
+    {
+        const lookup_type<K> & probe = key;
+        Buckets *buckets = shard.buckets.load (std::memory_order_relaxed);
+        std::atomic<Node *> *link = &buckets->heads[hash & buckets->mask];
+        for (Node *node = link->load (std::memory_order_relaxed) ; node != nullptr ;
+             node = link->load (std::memory_order_relaxed))
+        {
+            if (node->hash == hash && equal (node->pair.first , probe))
+            {
+                return link;
+            }
+            link = &node->next;
+        }
+        return nullptr;
+    }
+
+    /**
+     * Publishes a new node at the head of its chain, and grows the shard if it got too full, the
+     * mutex of the shard must be held
+     * @param shard Shard of the node
+     * @param node Node to link
+     */
+    void _link (Shard & shard , Node *node)
+    {
+        Buckets *buckets = shard.buckets.load (std::memory_order_relaxed);
+        std::atomic<Node *> & head = buckets->heads[node->hash & buckets->mask];
+        node->next.store (head.load (std::memory_order_relaxed) , std::memory_order_relaxed);
+        head.store (node , std::memory_order_release);
+        int size = shard.size.load (std::memory_order_relaxed) + 1;
+        shard.size.store (size , std::memory_order_relaxed);
+        if (size > UPPER_BOUND * (buckets->mask + 1))
+        {
+            _resize (shard , (buckets->mask + 1) * CAPACITY_CHANGE);
+        }
+    }
+
+    /**
+     * Relinks every node of a shard into new buckets under an odd seqlock, the mutex of the shard
+     * must be held. The nodes are moved head first, so a moved node only ever points to a node
+     * moved before it and a reader caught in the middle never loops
+     * @param shard Shard to resize
+     * @param capacity New amount of buckets, a power of two
+     */
+    void _resize (Shard & shard , size_t capacity)
+    {
+        Buckets *old = shard.buckets.load (std::memory_order_relaxed);
+        Buckets *buckets = new Buckets (capacity);
+        uint64_t version = shard.version.load (std::memory_order_relaxed);
+        shard.version.store (version + 1 , std::memory_order_relaxed);
+        for (size_t i = 0 ; i <= old->mask ; ++ i)
+        {
+            Node *node = old->heads[i].load (std::memory_order_relaxed);
+            while (node != nullptr)
+            {
+                Node *next = node->next.load (std::memory_order_relaxed);
+                std::atomic<Node *> & head = buckets->heads[node->hash & buckets->mask];
+                // released, so a reader that follows the relinked node then sees the odd version
+                node->next.store (head.load (std::memory_order_relaxed) , std::memory_order_release);
+                head.store (node , std::memory_order_relaxed);
+                node = next;
+            }
+        }
+        shard.buckets.store (buckets , std::memory_order_release);
+        shard.version.store (version + 2 , std::memory_order_release);
+        _retire (shard , nullptr , old);
+    }
+
+    /**
+     * Hands an unlinked node or bucket array to the epoch, and frees the ones no reader can see
+     * anymore once enough piled up, the mutex of the shard must be held
+     * @param shard Shard it was unlinked from
+     * @param node Unlinked node, or nullptr
+     * @param buckets Unlinked buckets, or nullptr
+     */
+    void _retire (Shard & shard , Node *node , Buckets *buckets)
+    {
+        shard.retired.push_back (Retired {EpochDomain::now () , node , buckets});
+        if (shard.retired.size () < RETIRE_BATCH)
+        {
+            return;
+        }
+        uint64_t epoch = EpochDomain::advance ();
+        size_t kept = 0;
+        for (const Retired & retired : shard.retired)
+        {
+            if (retired.epoch + 2 <= epoch)
+            {
+                delete retired.node;
+                delete retired.buckets;
+            }
+            else
+            {
+                shard.retired[kept ++] = retired;
+            }
+        }
+        shard.retired.resize (kept);
+    }
+
+    /**
+     * Frees a chain
+     * @param node Head of the chain
+     */
+    static void _release (Node *node)
+    {
+        while (node != nullptr)
+        {
+            Node *next = node->next.load (std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+    }
+};
+
+#endif //CPPEX3_CONCURRENTHASHMAP_HPP
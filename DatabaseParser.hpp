@@ -0,0 +1,154 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_DATABASEPARSER_HPP
+#define CPPEX3_DATABASEPARSER_HPP
+//---------------DEFINES--------------
+#define PARALLEL_PARSE (1 << 20)
+
+#define FIELD_SEPARATOR ','
+
+#define LINE_SEPARATOR '\n'
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Parser of the CSV database, one "phrase,score" per line.
+ * The lines are validated and split in place: an entry is a view of its phrase inside the
+ * buffer and its score, so nothing is copied until the phrase is stored. A line is valid if it
+ * has exactly one comma, a non empty phrase before it and a non empty score of decimal digits
+ * that fits an int after it. Lines end at a newline, the last line may end at the end of the
+ * buffer instead, and an empty line is invalid.
+ * Large buffers are cut at newlines into one chunk per thread and the chunks are parsed at once,
+ * the entries still come out in file order.
+ */
+class DatabaseParser
+{
+public:
+    typedef std::pair<std::string_view , int> Entry;
+
+    /**
+     * Parses the whole buffer
+     * @param data Start of the buffer
+     * @param size Size of the buffer
+     * @param entries Filled with the entries in file order
+     * @param threads Amount of threads, only used for buffers of PARALLEL_PARSE bytes or more
+     * @return true if invalid false otherwise
+     */
+    static bool parse (const char *data , size_t size , std::vector<Entry> & entries ,
+                       unsigned int threads = 1)
+    {
+        entries.clear ();
+        if (size < PARALLEL_PARSE || threads <= 1)
+        {
+            return _parseChunk (data , data + size , entries);
+        }
+        std::vector<const char *> bounds (threads + 1 , data + size);
+        bounds[0] = data;
+        for (unsigned int t = 1 ; t < threads ; ++ t)
+        {
+            // every chunk but the last ends right after a newline
+            const char *from = std::max (bounds[t - 1] , data + size * t / threads);
+            const char *newline = (const char *) std::memchr (from , LINE_SEPARATOR ,
+                                                              (size_t) (data + size - from));
+            bounds[t] = newline == nullptr ? data + size : newline + 1;
+        }
+        std::vector<std::vector<Entry>> parts (threads);
+        std::vector<char> invalid (threads , false);
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0 ; t < threads ; ++ t)
+        {
+            workers.emplace_back ([&bounds , &parts , &invalid , t] ()
+                                  {
+                                      invalid[t] = _parseChunk (bounds[t] , bounds[t + 1] ,
+                                                                parts[t]);
+                                  });
+        }
+        for (auto & worker : workers)
+        {
+            worker.join ();
+        }
+        size_t total = 0;
+        for (unsigned int t = 0 ; t < threads ; ++ t)
+        {
+            if (invalid[t])
+            {
+                return true;
+            }
+            total += parts[t].size ();
+        }
+        entries.reserve (total);
+        for (const auto & part : parts)
+        {
+            entries.insert (entries.end () , part.begin () , part.end ());
+        }
+        return false;
+    }
+
+    /**
+     * Validates and splits one line, without its newline
+     * @param line Line to parse
+     * @param entry Set to the phrase and score of the line
+     * @return true if invalid false otherwise
+     */
+    static bool parseLine (std::string_view line , Entry & entry)
+    {
+        size_t comma = line.find (FIELD_SEPARATOR);
+        if (comma == std::string_view::npos || comma == 0 || comma + 1 == line.size () ||
+            line.find (FIELD_SEPARATOR , comma + 1) != std::string_view::npos)
+        {
+            return true;
+        }
+        int64_t score = 0;
+        for (size_t i = comma + 1 ; i < line.size () ; ++ i)
+        {
+            if (line[i] < '0' || line[i] > '9')
+            {
+                return true;
+            }
+            score = score * 10 + (line[i] - '0');
+            if (score > INT_MAX)
+            {
+                return true;
+            }
+        }
+        entry = Entry (line.substr (0 , comma) , (int) score);
+        return false;
+    }
+
+private:
+    /**
+     * Parses the lines of a chunk
+     * @param begin Start of the chunk, the start of a line
+     * @param end End of the chunk
+     * @param entries Entries to append to
+     * @return true if invalid false otherwise
+     */
+    static bool _parseChunk (const char *begin , const char *end , std::vector<Entry> & entries)
+    {
+        Entry entry;
+        while (begin < end)
+        {
+            const char *newline = (const char *) std::memchr (begin , LINE_SEPARATOR ,
+                                                              (size_t) (end - begin));
+            const char *stop = newline == nullptr ? end : newline;
+            if (parseLine (std::string_view (begin , (size_t) (stop - begin)) , entry))
+            {
+                return true;
+            }
+            entries.push_back (entry);
+            begin = stop + 1;
+        }
+        return false;
+    }
+};
+
+#endif //CPPEX3_DATABASEPARSER_HPP
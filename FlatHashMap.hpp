@@ -0,0 +1,983 @@
+//
+// Created by mikemerzl on 17/01/2020.
+//
+
+#ifndef CPPEX3_FLATHASHMAP_HPP
+#define CPPEX3_FLATHASHMAP_HPP
+//---------------DEFINES--------------
+#define FLAT_UPPER_BOUND 0.875
+
+#define EMPTY_SLOT 0
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "HashMap.hpp"
+
+template<typename KeyT , typename ValueT , typename Hash = KeyHash<KeyT> ,
+        typename KeyEqual = std::equal_to<>>
+/**
+ * Open addressing hash map of keyT and ValueT pairs, with the interface of HashMap, so one can
+ * replace the other by changing the type.
+ * Pairs are kept in one flat slot array and placed with Robin Hood hashing. Every slot holds its
+ * distance from its home slot (EMPTY_SLOT when free) and the low bits of the mixed hash of its
+ * key next to the pair, so a probe walks one contiguous run of slots, compares the key only
+ * when the stored hash matches, and a resize never hashes a key again. Erase shifts the rest of
+ * the run back by one, so no tombstones are left.
+ * The hash is mixed before it picks a home slot, so keys whose hashes differ only in the high
+ * bits (e.g. std::hash of multiples of a power of two) do not pile up in one run. Distances are
+ * full words, so a run is never too long to be stored, a bad hash makes probes slow but never
+ * makes the map grow.
+ * The map grows once an insert would pass the upper load factor and shrinks once an erase drops
+ * below the lower one, with the same hysteresis as HashMap.
+ * Heterogeneous lookups are done without converting the key when both Hash and KeyEqual are
+ * transparent.
+ * @tparam KeyT type of Key
+ * @tparam ValueT type of Value
+ * @tparam Hash type of the hash of the keys
+ * @tparam KeyEqual type of the equality of the keys
+ */
+class FlatHashMap
+{
+public:
+    typedef std::pair<KeyT , ValueT> value_type;
+
+    class const_iterator;
+
+private:
+    /**
+     * One slot of the array, the pair is alive only while dist != EMPTY_SLOT
+     */
+    struct Slot
+    {
+        /**
+         * Def const, a free slot
+         */
+        Slot () : dist (EMPTY_SLOT) , hash (0)
+        {
+        }
+
+        /**
+         * Destructor, the pair is destroyed by the map
+         */
+        ~Slot ()
+        {
+        }
+
+        /**
+         * distance from the home slot plus one, EMPTY_SLOT if the slot is free
+         */
+        uint32_t dist;
+        /**
+         * low bits of the mixed hash of the key, enough to find the home slot at any capacity
+         */
+        uint32_t hash;
+
+        union
+        {
+            value_type pair;
+        };
+    };
+
+public:
+    /**
+     * Def const
+     */
+    FlatHashMap () : FlatHashMap (Hash ())
+    {
+    }
+
+    /**
+     * Constcutor for the given hash and equality
+     * @param hash Hash of the keys
+     * @param keyEqual Equality of the keys
+     */
+    explicit FlatHashMap (const Hash & hash , const KeyEqual & keyEqual = KeyEqual ()) :
+            _capacity (INITIAL_CAPACITY) , _size (STARTING_SIZE) , loadFactor (LOWER_BOUND) ,
+            upFactor (FLAT_UPPER_BOUND) , autoShrink (true) , hasher (hash) , equal (keyEqual)
+    {
+        slots = new Slot[_capacity];
+    }
+
+    /**
+     * Constcutor for tow vectors
+     * @param Key Vector made of keys
+     * @param Value Vector made of values
+     */
+    FlatHashMap (const std::vector<KeyT> & Key , const std::vector<ValueT> & Value) :
+            FlatHashMap ()
+    {
+        if (Key.size () != Value.size ())
+        {
+            throw sizeException ();
+        }
+        reserve ((int) Key.size ());
+        for (size_t i = 0 ; i < Key.size () ; ++ i)
+        {
+            insert_or_assign (Key[i] , Value[i]);
+        }
+    }
+
+    /**
+     * Constcutor for a range of pairs, a later pair overrides an earlier one with the same key
+     * @tparam InputIt type of the iterators
+     * @param first Start of the range
+     * @param last End of the range
+     */
+    template<typename InputIt>
+    FlatHashMap (InputIt first , InputIt last) : FlatHashMap ()
+    {
+        typedef typename std::iterator_traits<InputIt>::iterator_category category;
+        if constexpr (std::is_base_of<std::forward_iterator_tag , category>::value)
+        {
+            reserve ((int) std::distance (first , last));
+        }
+        for ( ; first != last ; ++ first)
+        {
+            insert_or_assign (first->first , first->second);
+        }
+    }
+
+    /**
+     * Constcutor for a list of pairs
+     * @param pairs Pairs to insert
+     */
+    FlatHashMap (std::initializer_list<value_type> pairs) : FlatHashMap (pairs.begin () ,
+                                                                        pairs.end ())
+    {
+    }
+
+    /**
+     * Copy Constcutor, the copy has the capacity and the slot layout of the other map
+     * @param other Map to copy
+     */
+    FlatHashMap (const FlatHashMap & other) : FlatHashMap (other.hasher , other.equal)
+    {
+        loadFactor = other.loadFactor;
+        upFactor = other.upFactor;
+        autoShrink = other.autoShrink;
+        // a moved from map has no slots, its copy keeps the initial ones
+        if (other._capacity > 0)
+        {
+            Slot *fresh = new Slot[other._capacity];
+            delete[] slots;
+            slots = fresh;
+            _capacity = other._capacity;
+        }
+        for (int i = 0 ; i < other._capacity ; ++ i)
+        {
+            if (other.slots[i].dist != EMPTY_SLOT)
+            {
+                ::new ((void *) &slots[i].pair) value_type (other.slots[i].pair);
+                slots[i].hash = other.slots[i].hash;
+                slots[i].dist = other.slots[i].dist;
+                ++ _size;
+            }
+        }
+    }
+
+    /**
+     * Move Constcutor, takes the slots of the other map without copying. The other map is left
+     * empty with no slots and allocates again on its next insert.
+     * @param other Map to move
+     */
+    FlatHashMap (FlatHashMap && other) noexcept : _capacity (other._capacity) ,
+                                                  _size (other._size) ,
+                                                  loadFactor (other.loadFactor) ,
+                                                  upFactor (other.upFactor) ,
+                                                  autoShrink (other.autoShrink) ,
+                                                  hasher (std::move (other.hasher)) ,
+                                                  equal (std::move (other.equal)) ,
+                                                  slots (other.slots)
+    {
+        other.slots = nullptr;
+        other._capacity = 0;
+        other._size = STARTING_SIZE;
+    }
+
+    /**
+     * Destructor
+     */
+    ~FlatHashMap ()
+    {
+        _release (slots , _capacity);
+    }
+
+    /**
+     * copies the map, with its load factors
+     * @param other map to copy
+     * @return FlatHashMap of the copied map
+     */
+    FlatHashMap & operator= (const FlatHashMap & other)
+    {
+        if (this != &other)
+        {
+            FlatHashMap copy (other);
+            swap (copy);
+        }
+        return *this;
+    }
+
+    /**
+     * Moves the map
+     * @param other map to move, left empty
+     * @return This map
+     */
+    FlatHashMap & operator= (FlatHashMap && other) noexcept
+    {
+        if (this != &other)
+        {
+            FlatHashMap moved (std::move (other));
+            swap (moved);
+        }
+        return *this;
+    }
+
+    /**
+     * Exchanges the contents and the settings of the maps without copying any element
+     * @param other map to exchange with
+     */
+    void swap (FlatHashMap & other) noexcept
+    {
+        std::swap (_capacity , other._capacity);
+        std::swap (_size , other._size);
+        std::swap (loadFactor , other.loadFactor);
+        std::swap (upFactor , other.upFactor);
+        std::swap (autoShrink , other.autoShrink);
+        std::swap (hasher , other.hasher);
+        std::swap (equal , other.equal);
+        std::swap (slots , other.slots);
+    }
+
+    /**
+     * Exchanges the contents of the maps
+     * @param first first map
+     * @param second second map
+     */
+    friend void swap (FlatHashMap & first , FlatHashMap & second) noexcept
+    {
+        first.swap (second);
+    }
+
+    /**
+     * Sets the load factors the map resizes at
+     * @param lower Load factor under which erase shrinks the map, 0 to never shrink
+     * @param upper Load factor over which insert grows the map, at most 1
+     * Throws sizeException unless 0 <= lower < upper / CAPACITY_CHANGE and upper <= 1
+     */
+    void setLoadFactors (double lower , double upper)
+    {
+        if (! (lower >= 0 && upper > 0 && upper <= 1 && lower * CAPACITY_CHANGE < upper))
+        {
+            throw sizeException ();
+        }
+        loadFactor = lower;
+        upFactor = upper;
+    }
+
+    /**
+     * Turns shrinking on erase on or off. Turning it back on shrinks the map if it is under the
+     * lower load factor.
+     * @param enable true to shrink on erase false otherwise
+     */
+    void setAutoShrink (bool enable)
+    {
+        autoShrink = enable;
+        if (enable)
+        {
+            _shrink ();
+        }
+    }
+
+    /**
+     * Grows the map so the given amount of elements fits without another resize
+     * @param amount Amount of elements
+     */
+    void reserve (int amount)
+    {
+        int newCapacity = _fitting (amount);
+        if (newCapacity > _capacity)
+        {
+            _rehash (newCapacity);
+        }
+    }
+
+    /**
+     * Shrinks the map to the smallest capacity that holds the current elements
+     */
+    void shrink_to_fit ()
+    {
+        int newCapacity = _fitting (_size);
+        if (newCapacity != _capacity)
+        {
+            _rehash (newCapacity);
+        }
+    }
+
+    /**
+     * Inserts the given key with value, or assigns the value if the key is already there
+     * @param key Key to insert
+     * @param value Value to insert
+     * @return true if inserted false otherwise
+     */
+    template<typename K = KeyT , typename V = ValueT>
+    bool insert (K && key , V && value)
+    {
+        return insert_or_assign (std::forward<K> (key) , std::forward<V> (value)).second;
+    }
+
+    /**
+     * Finds the given key, string keyed maps can be probed with any string like type
+     * @param key Key to find
+     * @return Iterator to the pair of the key, end () if missing
+     */
+    template<typename K = KeyT>
+    const_iterator find (const K & key) const
+    {
+        const lookup_type<K> & probe = key;
+        int index = _find (_mix (probe) , probe);
+        return index == - 1 ? end () : const_iterator (slots , index , _capacity);
+    }
+
+    /**
+     * Inserts the key with a value constructed from the arguments, if the key is missing
+     * @param key Key to insert
+     * @param args Arguments for the value
+     * @return Iterator to the pair of the key, and true if inserted false if already there
+     */
+    template<typename... Args>
+    std::pair<const_iterator , bool> try_emplace (const KeyT & key , Args && ... args)
+    {
+        return _result (_tryEmplace (key , std::forward<Args> (args)...));
+    }
+
+    /**
+     * Inserts the key with a value constructed from the arguments, if the key is missing
+     * @param key Key to insert, moved from only if inserted
+     * @param args Arguments for the value
+     * @return Iterator to the pair of the key, and true if inserted false if already there
+     */
+    template<typename... Args>
+    std::pair<const_iterator , bool> try_emplace (KeyT && key , Args && ... args)
+    {
+        return _result (_tryEmplace (std::move (key) , std::forward<Args> (args)...));
+    }
+
+    /**
+     * Inserts the key with the value, or assigns the value if the key is already there
+     * @param key Key to insert
+     * @param value Value to insert or assign
+     * @return Iterator to the pair of the key, and true if inserted false if assigned
+     */
+    template<typename V>
+    std::pair<const_iterator , bool> insert_or_assign (const KeyT & key , V && value)
+    {
+        return _assign (_tryEmplace (key , std::forward<V> (value)) , std::forward<V> (value));
+    }
+
+    /**
+     * Inserts the key with the value, or assigns the value if the key is already there
+     * @param key Key to insert, moved from only if inserted
+     * @param value Value to insert or assign
+     * @return Iterator to the pair of the key, and true if inserted false if assigned
+     */
+    template<typename V>
+    std::pair<const_iterator , bool> insert_or_assign (KeyT && key , V && value)
+    {
+        return _assign (_tryEmplace (std::move (key) , std::forward<V> (value)) ,
+                        std::forward<V> (value));
+    }
+
+    /**
+     * Constructs a pair from the arguments and inserts it if its key is missing
+     * @param args Arguments for the pair
+     * @return Iterator to the pair of the key, and true if inserted false if already there
+     */
+    template<typename... Args>
+    std::pair<const_iterator , bool> emplace (Args && ... args)
+    {
+        value_type pair (std::forward<Args> (args)...);
+        return _result (_tryEmplace (std::move (pair.first) , std::move (pair.second)));
+    }
+
+    /**
+     * Clears the map of items, the capacity is kept
+     */
+    void clear ()
+    {
+        for (int i = 0 ; i < _capacity ; ++ i)
+        {
+            if (slots[i].dist != EMPTY_SLOT)
+            {
+                slots[i].pair.~value_type ();
+                slots[i].dist = EMPTY_SLOT;
+            }
+        }
+        _size = STARTING_SIZE;
+    }
+
+    /**
+     * Checks if the key given is already in the map
+     * @param key Key to check
+     * @return true if contains false otherwise
+     */
+    template<typename K = KeyT>
+    bool containsKey (const K & key) const
+    {
+        const lookup_type<K> & probe = key;
+        return _find (_mix (probe) , probe) != - 1;
+    }
+
+    /**
+     * check if the map is empty
+     * @return true if empty false otherwise
+     */
+    bool empty () const
+    {
+        return _size == 0;
+    }
+
+    /**
+     * Erases the key given, later slots of the probe run are shifted back by one so no
+     * tombstones are left behind.
+     * @param key Key to earse
+     * @return true if erased false otherwise
+     */
+    template<typename K = KeyT>
+    bool erase (const K & key)
+    {
+        const lookup_type<K> & probe = key;
+        int index = _find (_mix (probe) , probe);
+        if (index == - 1)
+        {
+            return false;
+        }
+        int mask = _capacity - 1;
+        int next = (index + 1) & mask;
+        while (slots[next].dist > 1)
+        {
+            slots[index].pair = std::move (slots[next].pair);
+            slots[index].hash = slots[next].hash;
+            slots[index].dist = slots[next].dist - 1;
+            index = next;
+            next = (next + 1) & mask;
+        }
+        slots[index].pair.~value_type ();
+        slots[index].dist = EMPTY_SLOT;
+        -- _size;
+        if (autoShrink)
+        {
+            _shrink ();
+        }
+        return true;
+    }
+
+    /**
+     * Current load factor of the map
+     * @return Load factor
+     */
+    double getLoadFactor () const
+    {
+        return _capacity == 0 ? 0 : (double) _size / _capacity;
+    }
+
+    /**
+     * returns the value of the given key, inserting a default value if missing
+     * @param key Key to return its value
+     * @return ValueT of the given key
+     */
+    ValueT & operator[] (const KeyT & key)
+    {
+        // the insert may move the slots, so they are read after it
+        int index = _tryEmplace (key).first;
+        return slots[index].pair.second;
+    }
+
+    /**
+     * returns the value of the given key, inserting a default value if missing
+     * @param key Key to return its value, moved from only if inserted
+     * @return ValueT of the given key
+     */
+    ValueT & operator[] (KeyT && key)
+    {
+        // the insert may move the slots, so they are read after it
+        int index = _tryEmplace (std::move (key)).first;
+        return slots[index].pair.second;
+    }
+
+    /**
+     * return the value of the given key if its in the map default value otherwise
+     * @param key Key whose ValueT to return
+     * @return the value of the given key if its in the map default value otherwise
+     */
+    ValueT operator[] (const KeyT & key) const
+    {
+        int found = _find (_mix (key) , key);
+        if (found == - 1)
+        {
+            return ValueT {};
+        }
+        return slots[found].pair.second;
+    }
+
+    /**
+     * Returns the current capacity of the map
+     * @return Capacity of the map
+     */
+    int capacity () const
+    {
+        return _capacity;
+    }
+
+    /**
+     * return the number of elements in the map
+     * @return number of elements in the map
+     */
+    int size () const
+    {
+        return _size;
+    }
+
+    /**
+     * return the ValueT of the given key,if doesnt exist throw exception
+     * @param key Key to check
+     * @return ValueT if key exists indexException otherwise
+     */
+    template<typename K = KeyT>
+    ValueT & at (const K & key)
+    {
+        return slots[_existing (key)].pair.second;
+    }
+
+    /**
+     * return the ValueT of the given key,if doesnt exist throw exception
+     * @param key Key to check
+     * @return ValueT if key exists indexException otherwise
+     */
+    template<typename K = KeyT>
+    const ValueT & at (const K & key) const
+    {
+        return slots[_existing (key)].pair.second;
+    }
+
+    /**
+     * Check if maps equal
+     * @param other other map to check
+     * @return true if equal false otherwise
+     */
+    bool operator== (const FlatHashMap & other) const
+    {
+        if (_size != other._size)
+        {
+            return false;
+        }
+        for (const auto & pair : *this)
+        {
+            const_iterator found = other.find (pair.first);
+            if (found == other.end () || ! (found->second == pair.second))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Check if maps are not equal
+     * @param other other map to check
+     * @return true if not equal false otherwise
+     */
+    bool operator!= (const FlatHashMap & other) const
+    {
+        return ! (*this == other);
+    }
+
+    /**
+     * Const Iterator class
+     */
+    class const_iterator
+    {
+    public:
+        typedef int difference_type;
+        typedef std::pair<KeyT , ValueT> value_type;
+        typedef const std::pair<KeyT , ValueT> *pointer;
+        typedef const std::pair<KeyT , ValueT> & reference;
+        typedef std::forward_iterator_tag iterator_category;
+
+        /**
+         * Constcutor for iterator
+         * @param slots Slot array of the map
+         * @param index Starting slot, moved on to the first pair from there
+         * @param capacity Amount of slots
+         */
+        const_iterator (const Slot *slots = nullptr , int index = 0 , int capacity = 0) :
+                _slots (slots) , _index (index) , _capacity (capacity)
+        {
+            _skipEmpty ();
+        }
+
+        /**
+         * return the current pair
+         * @return current pair
+         */
+        reference operator* () const
+        {
+            return _slots[_index].pair;
+        }
+
+        /**
+         * Pointer to the current pair
+         * @return Pointer to the current pair
+         */
+        pointer operator-> () const
+        {
+            return &_slots[_index].pair;
+        }
+
+        /**
+         * Advances the iterator foward
+         * @return Iterator after the advance
+         */
+        const_iterator & operator++ ()
+        {
+            ++ _index;
+            _skipEmpty ();
+            return *this;
+        }
+
+        /**
+         * Advances the iterator foward
+         * @return Iterator after the advance
+         */
+        const_iterator operator++ (int)
+        {
+            const_iterator tmp (*this);
+            ++ *this;
+            return tmp;
+        }
+
+        /**
+         * Checks if iterator not equal
+         * @param other Iterator to check
+         * @return true if not equal false otherwise
+         */
+        bool operator!= (const_iterator const & other) const
+        {
+            return _index != other._index;
+        }
+
+        /**
+         * Checks if iterator equal
+         * @param other Iterator to check
+         * @return true if equal false otherwise
+         */
+        bool operator== (const_iterator const & other) const
+        {
+            return _index == other._index;
+        }
+
+    private:
+        const Slot *_slots;
+        int _index;
+        int _capacity;
+
+        /**
+         * Moves the iterator to the next occupied slot, or to the end position.
+         */
+        void _skipEmpty ()
+        {
+            while (_index < _capacity && _slots[_index].dist == EMPTY_SLOT)
+            {
+                ++ _index;
+            }
+        }
+    };
+
+    /**
+     * Starting position of the iterator
+     * @return Starting position of the iterator
+     */
+    const_iterator begin () const
+    {
+        return const_iterator (slots , 0 , _capacity);
+    }
+
+    /**
+     * Starting position of the const_iterator
+     * @return Starting position of the iterator
+     */
+    const_iterator cbegin () const
+    {
+        return begin ();
+    }
+
+    /**
+     * End position of the iterator
+     * @return End position of the iterator
+     */
+    const_iterator end () const
+    {
+        return const_iterator (slots , _capacity , _capacity);
+    }
+
+    /**
+     * End position of the const_iterator
+     * @return End position of the iterator
+     */
+    const_iterator cend () const
+    {
+        return end ();
+    }
+
+private:
+    /**
+     * Type a key of type K is probed as, K itself if the hash and the equality are both
+     * transparent, KeyT otherwise
+     */
+    template<typename K>
+    using lookup_type = typename std::conditional<
+            isTransparent<Hash>::value && isTransparent<KeyEqual>::value , K , KeyT>::type;
+
+    /**
+     * current capacity, always a power of two, 0 once moved from
+     */
+    int _capacity;
+    /**
+     * current amount of elements
+     */
+    int _size;
+    /**
+     * load Factor for both up adn down
+     */
+    double loadFactor , upFactor;
+    /**
+     * true if erase shrinks the map
+     */
+    bool autoShrink;
+    /**
+     * hash of the keys
+     */
+    Hash hasher;
+    /**
+     * equality of the keys
+     */
+    KeyEqual equal;
+    /**
+     * the slots, nullptr once moved from
+     */
+    Slot *slots;
+
+    /**
+     * Destroys the pairs of a slot array and frees it
+     * @param array Slot array, may be nullptr
+     * @param capacity Amount of slots
+     */
+    static void _release (Slot *array , int capacity)
+    {
+        for (int i = 0 ; i < capacity ; ++ i)
+        {
+            if (array[i].dist != EMPTY_SLOT)
+            {
+                array[i].pair.~value_type ();
+            }
+        }
+        delete[] array;
+    }
+
+    /**
+     * Mixed hash of a key, the low bits pick its home slot
+     * @param key Key to hash
+     * @return Low bits of the mixed hash
+     */
+    template<typename K>
+    uint32_t _mix (const K & key) const
+    {
+        return (uint32_t) mixHash ((uint64_t) hasher (key));
+    }
+
+    /**
+     * Finds the slot holding the given key
+     * @param hash Mixed hash of the key
+     * @param key Key to look for
+     * @return Slot index, -1 if the key is not in the map
+     */
+    template<typename K>
+    int _find (uint32_t hash , const K & key) const
+    {
+        if (_capacity == 0)
+        {
+            return - 1;
+        }
+        int mask = _capacity - 1;
+        int index = (int) (hash & (uint32_t) mask);
+        // Robin Hood invariant: once a slot is closer to its home than we are, the key is absent
+        for (uint32_t probe = 1 ; slots[index].dist >= probe ; ++ probe)
+        {
+            if (slots[index].hash == hash && equal (slots[index].pair.first , key))
+            {
+                return index;
+            }
+            index = (index + 1) & mask;
+        }
+        return - 1;
+    }
+
+    /**
+     * Slot of a key that must be in the map
+     * @param key Key to look for
+     * @return Slot index
+     * Throws indexException if the key is missing
+     */
+    template<typename K>
+    int _existing (const K & key) const
+    {
+        const lookup_type<K> & probe = key;
+        int found = _find (_mix (probe) , probe);
+        if (found == - 1)
+        {
+            throw indexException {};
+        }
+        return found;
+    }
+
+    /**
+     * Places a pair whose key is not in the map, displacing richer pairs on the way. There is
+     * always a free slot, since the map grows before it is full.
+     * @param hash Mixed hash of the key
+     * @param pair Pair to place
+     * @return Slot the pair ended up in
+     */
+    int _place (uint32_t hash , value_type && pair)
+    {
+        value_type carry (std::move (pair));
+        int mask = _capacity - 1;
+        int index = (int) (hash & (uint32_t) mask);
+        int placed = - 1;
+        uint32_t probe = 1;
+        for ( ; slots[index].dist != EMPTY_SLOT ; index = (index + 1) & mask , ++ probe)
+        {
+            if (slots[index].dist < probe)
+            {
+                std::swap (carry , slots[index].pair);
+                std::swap (hash , slots[index].hash);
+                std::swap (probe , slots[index].dist);
+                placed = placed == - 1 ? index : placed;
+            }
+        }
+        ::new ((void *) &slots[index].pair) value_type (std::move (carry));
+        slots[index].hash = hash;
+        slots[index].dist = probe;
+        return placed == - 1 ? index : placed;
+    }
+
+    /**
+     * Hashes the key once and probes its run once, on a miss the pair is constructed and placed,
+     * after growing the map if needed
+     * @param key Key to insert
+     * @param args Arguments for the value
+     * @return Slot of the pair of the key, and true if inserted false if already there
+     */
+    template<typename K , typename... Args>
+    std::pair<int , bool> _tryEmplace (K && key , Args && ... args)
+    {
+        uint32_t hash = _mix (key);
+        int index = _find (hash , key);
+        if (index != - 1)
+        {
+            return std::make_pair (index , false);
+        }
+        value_type pair (std::piecewise_construct , std::forward_as_tuple (std::forward<K> (key)) ,
+                         std::forward_as_tuple (std::forward<Args> (args)...));
+        if ((_size + 1) > upFactor * _capacity)
+        {
+            _rehash (_fitting (_size + 1));
+        }
+        index = _place (hash , std::move (pair));
+        ++ _size;
+        return std::make_pair (index , true);
+    }
+
+    /**
+     * Iterator form of a result of _tryEmplace
+     * @param result Slot of the pair and true if inserted
+     * @return Iterator to the pair, and true if inserted
+     */
+    std::pair<const_iterator , bool> _result (std::pair<int , bool> result) const
+    {
+        return std::make_pair (const_iterator (slots , result.first , _capacity) , result.second);
+    }
+
+    /**
+     * Assigns the value to a pair that was already there
+     * @param result Slot of the pair and true if it was just inserted
+     * @param value Value to assign, not used if inserted
+     * @return Iterator to the pair, and true if inserted false if assigned
+     */
+    template<typename V>
+    std::pair<const_iterator , bool> _assign (std::pair<int , bool> result , V && value)
+    {
+        if (! result.second)
+        {
+            slots[result.first].pair.second = std::forward<V> (value);
+        }
+        return _result (result);
+    }
+
+    /**
+     * Smallest capacity that holds the given amount of elements under the upper load factor
+     * @param amount Amount of elements
+     * @return The capacity, a power of CAPACITY_CHANGE
+     */
+    int _fitting (int amount) const
+    {
+        int newCapacity = 1;
+        while (amount > upFactor * newCapacity)
+        {
+            newCapacity *= CAPACITY_CHANGE;
+        }
+        return newCapacity;
+    }
+
+    /**
+     * Halves the map while it is under the lower load factor, never under one slot
+     */
+    void _shrink ()
+    {
+        int newCapacity = _capacity;
+        while (newCapacity > 1 && (double) _size / newCapacity < loadFactor)
+        {
+            newCapacity /= CAPACITY_CHANGE;
+        }
+        if (newCapacity != _capacity)
+        {
+            _rehash (newCapacity);
+        }
+    }
+
+    /**
+     * Moves every pair into a new slot array, with the hashes stored in the slots
+     * @param newCapacity New capacity after rehash
+     */
+    void _rehash (int newCapacity)
+    {
+        Slot *previous = slots;
+        int previousCapacity = _capacity;
+        slots = new Slot[newCapacity];
+        _capacity = newCapacity;
+        for (int i = 0 ; i < previousCapacity ; ++ i)
+        {
+            if (previous[i].dist != EMPTY_SLOT)
+            {
+                _place (previous[i].hash , std::move (previous[i].pair));
+            }
+        }
+        _release (previous , previousCapacity);
+    }
+};
+
+#endif //CPPEX3_FLATHASHMAP_HPP
@@ -0,0 +1,535 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_FROZENHASHMAP_HPP
+#define CPPEX3_FROZENHASHMAP_HPP
+//---------------DEFINES--------------
+#define FROZEN_BUCKET_SIZE 4
+
+#define FROZEN_LOAD 0.98
+
+#define FROZEN_MAX_PILOT (1 << 16)
+
+#define FROZEN_MAX_KEYS 0x7fffffffU
+
+#define FROZEN_SEED_PRIME 0x9e3779b97f4a7c15ULL
+
+#define FROZEN_MAX_SEEDS 64
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <numeric>
+#include <utility>
+#include <vector>
+#include "HashMap.hpp"
+
+/**
+ * Build Exception
+ */
+class buildException : public std::exception
+{
+public:
+    /**
+     * Exception to be thrown when no minimal perfect hash is found for the keys, e.g. when two
+     * distinct keys have the same hash
+     * @return String of exception.
+     */
+    const char *what () const noexcept override
+    {
+        return "Invalid Keys";
+    }
+};
+
+template<typename KeyT , typename ValueT , typename Hash = KeyHash<KeyT> ,
+        typename KeyEqual = std::equal_to<>>
+/**
+ * Immutable map over a fixed set of keys, built once with a minimal perfect hash (PTHash style):
+ * the keys are split into small buckets by their hash, and every bucket gets a pilot, the first
+ * value that sends all its keys to free slots when mixed into their hash. The pairs are stored in
+ * one array with no empty slot, and a lookup is one pilot read, one hash and one key compare.
+ * Every slot also has the low bits of the hash of its key in a small array of its own, so most
+ * missing keys are turned away before the pairs, and the bytes of their keys, are touched.
+ * The pilots are searched over slightly more slots than keys, which keeps the search short, and
+ * the few keys that land past the last pair are sent through a small remap table into the holes.
+ * Nothing is mutated after construction, so any amount of threads can read a map at once without
+ * locking.
+ * The seed only changes how the full hashes are mixed, so two distinct keys with the same hash
+ * can never be told apart: building over such keys, or failing to place the keys with
+ * FROZEN_MAX_SEEDS seeds, throws buildException.
+ * @tparam KeyT type of Key
+ * @tparam ValueT type of Value
+ * @tparam Hash type of the hash of the keys
+ * @tparam KeyEqual type of the equality of the keys
+ */
+class FrozenHashMap
+{
+public:
+    typedef std::pair<KeyT , ValueT> value_type;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+    /**
+     * Def const, an empty map
+     */
+    FrozenHashMap () : FrozenHashMap (Hash ())
+    {
+    }
+
+    /**
+     * Constcutor of an empty map with the given hash and equality
+     * @param hash Hash of the keys
+     * @param equal Equality of the keys
+     */
+    explicit FrozenHashMap (const Hash & hash , const KeyEqual & equal = KeyEqual ()) :
+            slots (0) , seed (0) , hasher (hash) , equal (equal)
+    {
+    }
+
+    /**
+     * Constcutor for a range of pairs, a later pair overrides an earlier one with the same key
+     * @tparam InputIt type of the iterators
+     * @param first Start of the range
+     * @param last End of the range
+     * @param hash Hash of the keys
+     * @param equal Equality of the keys
+     */
+    template<typename InputIt>
+    FrozenHashMap (InputIt first , InputIt last , const Hash & hash = Hash () ,
+                   const KeyEqual & equal = KeyEqual ()) : FrozenHashMap (hash , equal)
+    {
+        std::vector<value_type> pairs;
+        for ( ; first != last ; ++ first)
+        {
+            pairs.emplace_back (*first);
+        }
+        _build (std::move (pairs));
+    }
+
+    /**
+     * Constcutor for a list of pairs, a later pair overrides an earlier one with the same key
+     * @param list Pairs to store
+     */
+    FrozenHashMap (std::initializer_list<value_type> list) : FrozenHashMap (list.begin () ,
+                                                                            list.end ())
+    {
+    }
+
+    /**
+     * Freezes the content of a map
+     * @tparam CacheHash cache policy of the map
+     * @tparam Allocator allocator of the map
+     * @param map Map to freeze
+     */
+    template<bool CacheHash , typename Allocator>
+    explicit FrozenHashMap (const HashMap<KeyT , ValueT , Hash , KeyEqual , CacheHash ,
+            Allocator> & map) : FrozenHashMap (map.begin () , map.end ())
+    {
+    }
+
+    /**
+     * Finds the given key, string keyed maps can be probed with any string like type
+     * @param key Key to find
+     * @return Iterator to the pair of the key, end () if missing
+     */
+    template<typename K = KeyT>
+    const_iterator find (const K & key) const
+    {
+        const lookup_type<K> & probe = key;
+        if (entries.empty ())
+        {
+            return end ();
+        }
+        uint64_t hash = _keyHash (probe);
+        size_t slot = _slotOf (hash);
+        if (fingerprints[slot] != (uint32_t) hash || ! equal (entries[slot].first , probe))
+        {
+            return end ();
+        }
+        return entries.begin () + slot;
+    }
+
+    /**
+     * Checks if the key given is in the map
+     * @param key Key to check
+     * @return true if contains false otherwise
+     */
+    template<typename K = KeyT>
+    bool containsKey (const K & key) const
+    {
+        return find (key) != end ();
+    }
+
+    /**
+     * return the ValueT of the given key,if doesnt exist throw exception
+     * @param key Key to check
+     * @return ValueT if key exists indexException otherwise
+     */
+    template<typename K = KeyT>
+    const ValueT & at (const K & key) const
+    {
+        const_iterator found = find (key);
+        if (found == end ())
+        {
+            throw indexException {};
+        }
+        return found->second;
+    }
+
+    /**
+     * return the number of elements in the map
+     * @return number of elements in the map
+     */
+    int size () const
+    {
+        return (int) entries.size ();
+    }
+
+    /**
+     * check if the map is empty
+     * @return true if empty false otherwise
+     */
+    bool empty () const
+    {
+        return entries.empty ();
+    }
+
+    /**
+     * Starting position of the iterator
+     * @return Starting position of the iterator
+     */
+    const_iterator begin () const
+    {
+        return entries.begin ();
+    }
+
+    /**
+     * End position of the iterator
+     * @return End position of the iterator
+     */
+    const_iterator end () const
+    {
+        return entries.end ();
+    }
+
+    /**
+     * Starting position of the iterator
+     * @return Starting position of the iterator
+     */
+    const_iterator cbegin () const
+    {
+        return entries.begin ();
+    }
+
+    /**
+     * End position of the iterator
+     * @return End position of the iterator
+     */
+    const_iterator cend () const
+    {
+        return entries.end ();
+    }
+
+private:
+    /**
+     * Type a key of type K is probed as, K itself if the hash and the equality are both
+     * transparent, KeyT otherwise
+     */
+    template<typename K>
+    using lookup_type = typename std::conditional<
+            isTransparent<Hash>::value && isTransparent<KeyEqual>::value , K , KeyT>::type;
+
+    /**
+     * the pairs, one per slot
+     */
+    std::vector<value_type> entries;
+    /**
+     * low bits of the hash of the key of every slot
+     */
+    std::vector<uint32_t> fingerprints;
+    /**
+     * pilot of every bucket
+     */
+    std::vector<uint32_t> pilots;
+    /**
+     * slot of the keys whose pilot sent them past the last pair, indexed from entries.size ()
+     */
+    std::vector<uint32_t> remap;
+    /**
+     * amount of slots the pilots were searched over, entries.size () and the remapped ones
+     */
+    uint32_t slots;
+    /**
+     * seed of the hash, changed when a search fails
+     */
+    uint64_t seed;
+    /**
+     * hash of the keys
+     */
+    Hash hasher;
+    /**
+     * equality of the keys
+     */
+    KeyEqual equal;
+
+    /**
+     * Maps a 32 bit value into [0 , range) with a multiply instead of a division
+     * @param value Value to map
+     * @param range Size of the range
+     * @return The mapped value
+     */
+    static uint32_t _reduce (uint64_t value , uint32_t range)
+    {
+        return (uint32_t) (((value & 0xffffffffULL) * range) >> 32);
+    }
+
+    /**
+     * Seeded hash of a key, mixed so a weak hash (e.g. std::hash of an int) still spreads
+     * @param key Key to hash
+     * @return Hash of the key
+     */
+    template<typename K>
+    uint64_t _keyHash (const K & key) const
+    {
+        return mixHash ((uint64_t) hasher (key) ^ seed);
+    }
+
+    /**
+     * Slot a pilot sends a hash to
+     * @param hash Hash of the key
+     * @param pilot Pilot of the bucket of the key
+     * @return Slot in [0 , slots)
+     */
+    uint32_t _position (uint64_t hash , uint32_t pilot) const
+    {
+        return _reduce (mixHash (hash ^ (pilot * FROZEN_SEED_PRIME)) , slots);
+    }
+
+    /**
+     * Bucket of a hash
+     * @param hash Hash of the key
+     * @return The bucket
+     */
+    uint32_t _bucketOf (uint64_t hash) const
+    {
+        return _reduce (hash >> 32 , (uint32_t) pilots.size ());
+    }
+
+    /**
+     * Slot of the pair of a hash
+     * @param hash Hash of the key
+     * @return Index into the pairs
+     */
+    size_t _slotOf (uint64_t hash) const
+    {
+        uint32_t position = _position (hash , pilots[_bucketOf (hash)]);
+        return position < entries.size () ? position : remap[position - entries.size ()];
+    }
+
+    /**
+     * Builds the map over the given pairs
+     * @param pairs Pairs to store, may repeat a key
+     */
+    void _build (std::vector<value_type> && pairs)
+    {
+        if (pairs.size () > FROZEN_MAX_KEYS)
+        {
+            throw sizeException ();
+        }
+        if (_unique (pairs))
+        {
+            throw buildException ();
+        }
+        for (int tries = 1 ; ! _place (pairs) ; ++ tries)
+        {
+            if (tries == FROZEN_MAX_SEEDS)
+            {
+                throw buildException ();
+            }
+            seed += FROZEN_SEED_PRIME;
+        }
+    }
+
+    /**
+     * Drops every pair whose key appears again later in the pairs
+     * @param pairs Pairs to clean
+     * @return true if two distinct keys are left with the same hash false otherwise
+     */
+    bool _unique (std::vector<value_type> & pairs) const
+    {
+        std::vector<size_t> hashes (pairs.size ());
+        std::vector<uint32_t> order (pairs.size ());
+        for (size_t i = 0 ; i < pairs.size () ; ++ i)
+        {
+            hashes[i] = hasher (pairs[i].first);
+        }
+        std::iota (order.begin () , order.end () , 0);
+        std::sort (order.begin () , order.end () , [&hashes] (uint32_t a , uint32_t b)
+        {
+            return hashes[a] != hashes[b] ? hashes[a] < hashes[b] : a > b;
+        });
+        std::vector<bool> dropped (pairs.size () , false);
+        bool collision = false;
+        for (size_t run = 0 , next ; run < order.size () ; run = next)
+        {
+            bool distinct = false;
+            // only keys with the same hash can be equal, the latest of them comes first
+            for (next = run + 1 ; next < order.size () && hashes[order[next]] == hashes[order[run]] ;
+                 ++ next)
+            {
+                for (size_t kept = run ; kept < next ; ++ kept)
+                {
+                    if (! dropped[order[kept]] &&
+                        equal (pairs[order[kept]].first , pairs[order[next]].first))
+                    {
+                        dropped[order[next]] = true;
+                        break;
+                    }
+                }
+                distinct = distinct || ! dropped[order[next]];
+            }
+            collision = collision || distinct;
+        }
+        size_t used = 0;
+        for (size_t i = 0 ; i < pairs.size () ; ++ i)
+        {
+            if (! dropped[i])
+            {
+                if (used != i)
+                {
+                    pairs[used] = std::move (pairs[i]);
+                }
+                ++ used;
+            }
+        }
+        pairs.erase (pairs.begin () + used , pairs.end ());
+        return collision;
+    }
+
+    /**
+     * Searches the pilots with the current seed and stores the pairs by their slot
+     * @param pairs Pairs to store, no key repeats, moved from on success
+     * @return true if every bucket got a pilot false otherwise
+     */
+    bool _place (std::vector<value_type> & pairs)
+    {
+        uint32_t amount = (uint32_t) pairs.size ();
+        if (amount == 0)
+        {
+            entries.clear ();
+            fingerprints.clear ();
+            pilots.clear ();
+            remap.clear ();
+            slots = 0;
+            return true;
+        }
+        slots = std::max (amount , (uint32_t) (amount / FROZEN_LOAD));
+        pilots.assign (amount / FROZEN_BUCKET_SIZE + 1 , 0);
+        std::vector<uint64_t> hashes (amount);
+        std::vector<uint32_t> start (pilots.size () + 1 , 0);
+        for (uint32_t i = 0 ; i < amount ; ++ i)
+        {
+            hashes[i] = _keyHash (pairs[i].first);
+            ++ start[_bucketOf (hashes[i]) + 1];
+        }
+        std::partial_sum (start.begin () , start.end () , start.begin ());
+        std::vector<uint32_t> members (amount);
+        std::vector<uint32_t> fill (start.begin () , start.end () - 1);
+        for (uint32_t i = 0 ; i < amount ; ++ i)
+        {
+            members[fill[_bucketOf (hashes[i])] ++] = i;
+        }
+        // the biggest buckets are the hardest to place, so they go while the slots are empty
+        std::vector<uint32_t> order (pilots.size ());
+        std::iota (order.begin () , order.end () , 0);
+        std::stable_sort (order.begin () , order.end () , [&start] (uint32_t a , uint32_t b)
+        {
+            return start[a + 1] - start[a] > start[b + 1] - start[b];
+        });
+        std::vector<bool> taken (slots , false);
+        std::vector<uint32_t> position (amount);
+        for (uint32_t bucket : order)
+        {
+            if (start[bucket + 1] == start[bucket])
+            {
+                break;
+            }
+            uint32_t pilot = 0;
+            while (! _tryPilot (hashes , members , start[bucket] , start[bucket + 1] , pilot ,
+                                taken , position))
+            {
+                if (++ pilot == FROZEN_MAX_PILOT)
+                {
+                    return false;
+                }
+            }
+            pilots[bucket] = pilot;
+        }
+        remap.assign (slots - amount , 0);
+        uint32_t hole = 0;
+        for (uint32_t i = 0 ; i < amount ; ++ i)
+        {
+            if (position[i] >= amount)
+            {
+                while (taken[hole])
+                {
+                    ++ hole;
+                }
+                taken[hole] = true;
+                remap[position[i] - amount] = hole;
+                position[i] = hole;
+            }
+        }
+        std::vector<uint32_t> owner (amount);
+        for (uint32_t i = 0 ; i < amount ; ++ i)
+        {
+            owner[position[i]] = i;
+        }
+        entries.clear ();
+        entries.reserve (amount);
+        fingerprints.resize (amount);
+        for (uint32_t i = 0 ; i < amount ; ++ i)
+        {
+            entries.push_back (std::move (pairs[owner[i]]));
+            fingerprints[i] = (uint32_t) hashes[owner[i]];
+        }
+        return true;
+    }
+
+    /**
+     * Tries to place all the keys of a bucket with the given pilot, takes their slots if it fits
+     * @param hashes Hash of every key
+     * @param members Keys grouped by bucket
+     * @param first Start of the bucket in the members
+     * @param last End of the bucket in the members
+     * @param pilot Pilot to try
+     * @param taken Slots already taken
+     * @param position Slot of every placed key
+     * @return true if placed false otherwise
+     */
+    bool _tryPilot (const std::vector<uint64_t> & hashes , const std::vector<uint32_t> & members ,
+                    uint32_t first , uint32_t last , uint32_t pilot , std::vector<bool> & taken ,
+                    std::vector<uint32_t> & position) const
+    {
+        for (uint32_t i = first ; i < last ; ++ i)
+        {
+            uint32_t slot = _position (hashes[members[i]] , pilot);
+            if (taken[slot])
+            {
+                // give back the slots the bucket already took with this pilot
+                for (uint32_t j = first ; j < i ; ++ j)
+                {
+                    taken[position[members[j]]] = false;
+                }
+                return false;
+            }
+            taken[slot] = true;
+            position[members[i]] = slot;
+        }
+        return true;
+    }
+};
+
+#endif //CPPEX3_FROZENHASHMAP_HPP
@@ -15,8 +15,31 @@
 
 #define CAPACITY_CHANGE 2
 
+#define REHASH_STEP 8
+
+#define PARALLEL_BUILD 65536
+
+#define OCCUPANCY_BITS 64
+
+#define STRING_HASH_SEED 0x9e3779b97f4a7c15ULL
+
+#define STRING_HASH_PRIME 0xff51afd7ed558ccdULL
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
 #include <vector>
+#include <exception>
 #include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 /**
  * Size Exception
@@ -50,22 +73,409 @@ public:
     }
 };
 
-template<typename KeyT , typename ValueT>
+template<typename KeyT>
+/**
+ * Hash of the keys, std::hash of the key type
+ * @tparam KeyT type of Key
+ */
+struct KeyHash
+{
+    /**
+     * Hashes the key
+     * @param key Key to hash
+     * @return Hash of the key
+     */
+    size_t operator() (const KeyT & key) const
+    {
+        return std::hash<KeyT> {} (key);
+    }
+};
+
+template<typename CharT , typename Traits , typename Alloc>
+/**
+ * Hash of string keys. Strings are hashed as string views, which std::hash guarantees to give
+ * the same value, so a std::string_view or a const char * can probe a string keyed map without
+ * building a string.
+ */
+struct KeyHash<std::basic_string<CharT , Traits , Alloc>>
+{
+    typedef void is_transparent;
+
+    /**
+     * Hashes the key
+     * @param key Key to hash
+     * @return Hash of the key
+     */
+    size_t operator() (std::basic_string_view<CharT , Traits> key) const
+    {
+        return std::hash<std::basic_string_view<CharT , Traits>> {} (key);
+    }
+};
+
+/**
+ * murmur3 64 bit finalizer, spreads every bit of a hash over all the bits of the result. Shared
+ * by the hashes and the tables that pick a shard, slot or block from the bits of a hash.
+ * @param value Value to mix
+ * @return Mixed value
+ */
+inline uint64_t mixHash (uint64_t value)
+{
+    value ^= value >> 33;
+    value *= STRING_HASH_PRIME;
+    value ^= value >> 33;
+    return value;
+}
+
+/**
+ * Fast non cryptographic hash of strings. The bytes are read sixteen at a time into two
+ * independent states, so the multiplies of the two halves overlap, and the result is finalized
+ * with the murmur3 mixer so the low bits used to pick a bucket depend on every byte. The values
+ * differ from std::hash. Transparent like KeyHash of strings.
+ */
+struct StringHash
+{
+    typedef void is_transparent;
+
+    /**
+     * Hashes the string
+     * @param key String to hash
+     * @return Hash of the string
+     */
+    size_t operator() (std::string_view key) const
+    {
+        const char *data = key.data ();
+        size_t length = key.size ();
+        uint64_t first = STRING_HASH_SEED ^ (length * STRING_HASH_PRIME);
+        uint64_t second = STRING_HASH_SEED;
+        size_t i = 0;
+        for ( ; i + 2 * sizeof (uint64_t) <= length ; i += 2 * sizeof (uint64_t))
+        {
+            first = (first ^ mixHash (_load (data + i))) * STRING_HASH_PRIME;
+            second = (second ^ mixHash (_load (data + i + sizeof (uint64_t)))) * STRING_HASH_PRIME;
+        }
+        if (i + sizeof (uint64_t) < length)
+        {
+            first = (first ^ mixHash (_load (data + i))) * STRING_HASH_PRIME;
+            i += sizeof (uint64_t);
+        }
+        if (i < length)
+        {
+            // the last eight bytes, overlapping the previous word, so the load has a fixed size
+            uint64_t word = 0;
+            if (length >= sizeof (uint64_t))
+            {
+                word = _load (data + length - sizeof (uint64_t));
+            }
+            else
+            {
+                for (size_t j = 0 ; j < length ; ++ j)
+                {
+                    word |= (uint64_t) (unsigned char) data[j] << (j * CHAR_BIT);
+                }
+            }
+            second = (second ^ mixHash (word)) * STRING_HASH_PRIME;
+        }
+        return (size_t) mixHash (first ^ ((second << 32) | (second >> 32)));
+    }
+
+private:
+    /**
+     * Reads eight bytes, aligned or not
+     * @param data Bytes to read
+     * @return The bytes as a word
+     */
+    static uint64_t _load (const char *data)
+    {
+        uint64_t word;
+        std::memcpy (&word , data , sizeof (word));
+        return word;
+    }
+};
+
+template<bool CacheHash>
+/**
+ * Hash part of a bucket element, empty: the hash is computed again whenever it is needed.
+ * @tparam CacheHash true to store the hash of the key
+ */
+struct StoredHash
+{
+    /**
+     * Constructor
+     * @param hash Hash of the key, not kept
+     */
+    explicit StoredHash (size_t hash)
+    {
+        (void) hash;
+    }
+
+    /**
+     * Checks if the key may have the given hash, always true without a stored hash
+     * @param hash Hash to check
+     * @return true if the key may have the hash false otherwise
+     */
+    bool sameHash (size_t hash) const
+    {
+        (void) hash;
+        return true;
+    }
+
+    /**
+     * Hash of the key
+     * @param hasher Hash of the map
+     * @param key Key to hash
+     * @return Hash of the key
+     */
+    template<typename Hash , typename K>
+    size_t hashOf (const Hash & hasher , const K & key) const
+    {
+        return hasher (key);
+    }
+};
+
+template<>
+/**
+ * Hash part of a bucket element that stores the hash of its key, so a resize never hashes a key
+ * again and a probe only compares the keys when the hashes are equal.
+ */
+struct StoredHash<true>
+{
+    /**
+     * Constructor
+     * @param hash Hash of the key
+     */
+    explicit StoredHash (size_t hash) : hash (hash)
+    {
+    }
+
+    /**
+     * Checks if the key has the given hash
+     * @param other Hash to check
+     * @return true if equal false otherwise
+     */
+    bool sameHash (size_t other) const
+    {
+        return hash == other;
+    }
+
+    /**
+     * Stored hash of the key
+     * @param hasher Hash of the map, not used
+     * @param key Key, not used
+     * @return Hash of the key
+     */
+    template<typename Hash , typename K>
+    size_t hashOf (const Hash & hasher , const K & key) const
+    {
+        (void) hasher;
+        (void) key;
+        return hash;
+    }
+
+    /**
+     * hash of the key
+     */
+    size_t hash;
+};
+
+template<typename T , typename Alloc , typename... Args>
+/**
+ * Arguments that construct a T from the given arguments and the allocator, following the uses
+ * allocator rules: the allocator is passed first, last or not at all, as T accepts it.
+ * @tparam T type to construct
+ * @param alloc Allocator to pass
+ * @param args Arguments of T, as references
+ * @return The arguments with the allocator added
+ */
+auto usesAllocatorArgs (const Alloc & alloc , std::tuple<Args...> && args)
+{
+    if constexpr (! std::uses_allocator<T , Alloc>::value)
+    {
+        return std::move (args);
+    }
+    else if constexpr (std::is_constructible<T , std::allocator_arg_t , const Alloc & , Args...>::value)
+    {
+        return std::tuple_cat (std::tuple<std::allocator_arg_t , const Alloc &> (std::allocator_arg ,
+                                                                                  alloc) ,
+                               std::move (args));
+    }
+    else
+    {
+        return std::tuple_cat (std::move (args) , std::tuple<const Alloc &> (alloc));
+    }
+}
+
+template<typename KeyT , typename ValueT , bool CacheHash , typename Alloc>
+/**
+ * Element of a bucket, the pair and, with CacheHash, the hash of its key.
+ * Allocators that construct with uses allocator construction (std::pmr, scoped adaptors) get the
+ * allocator_arg constructors, which pass the allocator on to the key and the value, so e.g. the
+ * characters of a std::pmr::string key come from the same arena as the buckets.
+ * @tparam KeyT type of Key
+ * @tparam ValueT type of Value
+ * @tparam CacheHash true to store the hash of the key with the pair
+ * @tparam Alloc allocator of the map
+ */
+struct HashEntry : std::pair<KeyT , ValueT> , StoredHash<CacheHash>
+{
+    typedef Alloc allocator_type;
+
+    /**
+     * Constructor
+     * @param hash Hash of the key
+     * @param args Arguments of the pair
+     */
+    template<typename... Args>
+    explicit HashEntry (size_t hash , Args && ... args) : std::pair<KeyT , ValueT> (
+            std::forward<Args> (args)...) , StoredHash<CacheHash> (hash)
+    {
+    }
+
+    /**
+     * Constructor with an allocator
+     * @param alloc Allocator of the key and the value
+     * @param hash Hash of the key
+     * @param key Arguments of the key
+     * @param value Arguments of the value
+     */
+    template<typename... K , typename... V>
+    HashEntry (std::allocator_arg_t , const Alloc & alloc , size_t hash , std::piecewise_construct_t ,
+               std::tuple<K...> key , std::tuple<V...> value) : std::pair<KeyT , ValueT> (
+            std::piecewise_construct , usesAllocatorArgs<KeyT> (alloc , std::move (key)) ,
+            usesAllocatorArgs<ValueT> (alloc , std::move (value))) , StoredHash<CacheHash> (hash)
+    {
+    }
+
+    /**
+     * Copy Constcutor with an allocator
+     * @param alloc Allocator of the key and the value
+     * @param other Element to copy
+     */
+    HashEntry (std::allocator_arg_t , const Alloc & alloc , const HashEntry & other) :
+            std::pair<KeyT , ValueT> (std::piecewise_construct ,
+                                      usesAllocatorArgs<KeyT> (alloc , std::forward_as_tuple (
+                                              other.first)) ,
+                                      usesAllocatorArgs<ValueT> (alloc , std::forward_as_tuple (
+                                              other.second))) , StoredHash<CacheHash> (other)
+    {
+    }
+
+    /**
+     * Move Constcutor with an allocator
+     * @param alloc Allocator of the key and the value
+     * @param other Element to move
+     */
+    HashEntry (std::allocator_arg_t , const Alloc & alloc , HashEntry && other) :
+            std::pair<KeyT , ValueT> (std::piecewise_construct ,
+                                      usesAllocatorArgs<KeyT> (alloc , std::forward_as_tuple (
+                                              std::move (other.first))) ,
+                                      usesAllocatorArgs<ValueT> (alloc , std::forward_as_tuple (
+                                              std::move (other.second)))) ,
+            StoredHash<CacheHash> (other)
+    {
+    }
+
+    HashEntry (const HashEntry & other) = default;
+
+    HashEntry (HashEntry && other) = default;
+
+    HashEntry & operator= (const HashEntry & other) = default;
+
+    HashEntry & operator= (HashEntry && other) = default;
+
+    /**
+     * Hash of the key
+     * @tparam Hash type of the hash
+     * @param hasher Hash of the map
+     * @return Hash of the key
+     */
+    template<typename Hash>
+    size_t hashOf (const Hash & hasher) const
+    {
+        return StoredHash<CacheHash>::hashOf (hasher , this->first);
+    }
+};
+
+template<typename Hash , typename = void>
+/**
+ * Checks if the hash accepts other types than the key type
+ */
+struct isTransparent : std::false_type
+{
+};
+
+template<typename Hash>
+/**
+ * Checks if the hash accepts other types than the key type
+ */
+struct isTransparent<Hash , std::void_t<typename Hash::is_transparent>> : std::true_type
+{
+};
+
+template<typename KeyT , typename ValueT , typename Hash = KeyHash<KeyT> ,
+        typename KeyEqual = std::equal_to<> , bool CacheHash = false ,
+        typename Allocator = std::allocator<std::pair<KeyT , ValueT>>>
 /**
  * Hash map of keyT and ValutT pairs
+ * In incremental rehash mode a resize keeps the old bucket array alive next to the new one and
+ * every insert or erase migrates REHASH_STEP old buckets, so no single operation pays for
+ * moving the whole map. Lookups check the old array for keys whose bucket was not migrated yet.
+ * The map grows once an insert would pass the upper load factor and shrinks once an erase drops
+ * below the lower one. The lower factor is kept under upper / CAPACITY_CHANGE, so the load right
+ * after a resize is always between the two and alternating inserts and erases can not resize on
+ * every operation.
+ * Heterogeneous lookups (e.g. a std::string_view in a std::string keyed map) are done without
+ * converting the key when both Hash and KeyEqual are transparent.
+ * The bucket array, the buckets and, for allocators that use uses allocator construction, the
+ * keys and values are all allocated with Allocator, rebound as needed. Copy, move and swap
+ * follow the propagate traits of the allocator like the standard containers.
  * @tparam KeyT type of Key
  * @tparam ValueT type of Value
+ * @tparam Hash type of the hash of the keys
+ * @tparam KeyEqual type of the equality of the keys
+ * @tparam CacheHash true to store the hash of every key with its pair
+ * @tparam Allocator allocator of the pairs
  */
 class HashMap
 {
+    typedef HashEntry<KeyT , ValueT , CacheHash , Allocator> Entry;
+    typedef std::allocator_traits<Allocator> AllocTraits;
+    typedef typename AllocTraits::template rebind_alloc<Entry> EntryAllocator;
+    typedef std::vector<Entry , EntryAllocator> Bucket;
+    typedef typename AllocTraits::template rebind_alloc<Bucket> BucketAllocator;
+    typedef std::allocator_traits<BucketAllocator> BucketTraits;
+
 public:
+    class const_iterator;
+
     /**
      * Def const
      */
-    HashMap () : _capacity (INITIAL_CAPACITY) , _size (STARTING_SIZE) , loadFactor (LOWER_BOUND) ,
-                 upFactor (UPPER_BOUND)
+    HashMap () : HashMap (Hash ())
+    {
+    }
+
+    /**
+     * Constcutor for the given hash, equality and allocator
+     * @param hash Hash of the keys
+     * @param keyEqual Equality of the keys
+     * @param alloc Allocator of the map
+     */
+    explicit HashMap (const Hash & hash , const KeyEqual & keyEqual = KeyEqual () ,
+                      const Allocator & alloc = Allocator ()) :
+            _capacity (INITIAL_CAPACITY) , _size (STARTING_SIZE) , loadFactor (LOWER_BOUND) ,
+            upFactor (UPPER_BOUND) , oldMap (nullptr) , oldCapacity (0) , migrated (0) ,
+            incremental (false) , autoShrink (true) , hasher (hash) , equal (keyEqual) ,
+            allocator (alloc)
+    {
+        map = _allocate (_capacity);
+    }
+
+    /**
+     * Constcutor for the given allocator
+     * @param alloc Allocator of the map
+     */
+    explicit HashMap (const Allocator & alloc) : HashMap (Hash () , KeyEqual () , alloc)
     {
-        map = new std::vector<std::pair<KeyT , ValueT>>[_capacity];
     }
 
 /**
@@ -73,45 +483,144 @@ public:
  * @param Key Vector made of keys
  * @param Value Vector made of values
  */
-    HashMap (const std::vector<KeyT> & Key , const std::vector<ValueT> & Value) : _capacity (
-            INITIAL_CAPACITY) ,
-                                                                                  _size (STARTING_SIZE) ,
-                                                                                  loadFactor (
-                                                                                          LOWER_BOUND) ,
-                                                                                  upFactor (
-                                                                                          UPPER_BOUND)
-    {
-        map = new std::vector<std::pair<KeyT , ValueT>>[_capacity];
+    HashMap (const std::vector<KeyT> & Key , const std::vector<ValueT> & Value) : HashMap ()
+    {
         if (Key.size () != Value.size ())
         {
-            delete[]map;
             throw sizeException ();
         }
-        for (unsigned int i = 0 ; i < Key.size () ; ++ i)
+        _bulkInsert (Key.size () , [&Key , &Value] (size_t i)
         {
-            insert (Key[i] , Value[i]);
-        }
+            return std::pair<const KeyT & , const ValueT &> (Key[i] , Value[i]);
+        } , 0);
+    }
 
+    /**
+     * Constcutor for a range of pairs, a later pair overrides an earlier one with the same key
+     * @tparam InputIt type of the iterators
+     * @param first Start of the range
+     * @param last End of the range
+     */
+    template<typename InputIt>
+    HashMap (InputIt first , InputIt last) : HashMap ()
+    {
+        bulk_insert (first , last);
+    }
+
+    /**
+     * Constcutor for a list of pairs
+     * @param pairs Pairs to insert
+     */
+    HashMap (std::initializer_list<std::pair<KeyT , ValueT>> pairs) : HashMap ()
+    {
+        bulk_insert (pairs.begin () , pairs.end ());
     }
 
     /**
      * Copy Constcutor
      * @param other Hashmap to copy
      */
-    HashMap (const HashMap & other) : _capacity (INITIAL_CAPACITY) ,
-                                      _size (STARTING_SIZE) , loadFactor (LOWER_BOUND) ,
-                                      upFactor (UPPER_BOUND)
+    HashMap (const HashMap & other) : HashMap (
+            other , AllocTraits::select_on_container_copy_construction (other.allocator))
     {
-        _capacity = other.capacity ();
+    }
+
+    /**
+     * Copy Constcutor into the given allocator
+     * @param other Hashmap to copy
+     * @param alloc Allocator of the copy
+     */
+    HashMap (const HashMap & other , const Allocator & alloc) : _capacity (INITIAL_CAPACITY) ,
+                                                                _size (STARTING_SIZE) ,
+                                                                loadFactor (other.loadFactor) ,
+                                                                upFactor (other.upFactor) ,
+                                                                oldMap (nullptr) , oldCapacity (0) ,
+                                                                migrated (0) ,
+                                                                incremental (other.incremental) ,
+                                                                autoShrink (other.autoShrink) ,
+                                                                hasher (other.hasher) ,
+                                                                equal (other.equal) ,
+                                                                allocator (alloc)
+    {
+        // a moved from map has no buckets, its copy starts over with the initial ones
+        _capacity = other._capacity > 0 ? other._capacity : INITIAL_CAPACITY;
         _size = other.size ();
-        map = new std::vector<std::pair<KeyT , ValueT>>[_capacity];
-        for (int i = 0 ; i < other.capacity () ; ++ i)
+        map = _allocate (_capacity);
+        for (int i = 0 ; i < other._capacity ; ++ i)
+        {
+            map[i] = other.map[i];
+        }
+        if (other._capacity > 0)
+        {
+            std::memcpy (_occupancy (map , _capacity) , _occupancy (other.map , _capacity) ,
+                         _words (_capacity) * sizeof (uint64_t));
+        }
+        for (int i = other.migrated ; other.oldMap != nullptr && i < other.oldCapacity ; ++ i)
+        {
+            for (auto j = other.oldMap[i].begin () ; j != other.oldMap[i].end () ; ++ j)
+            {
+                int bucket = _bucketOf (j->hashOf (hasher));
+                map[bucket].push_back (*j);
+                _mark (map , _capacity , bucket);
+            }
+        }
+    }
+
+    /**
+     * Move Constcutor, takes the buckets of the other map without copying. The other map is
+     * left empty with no buckets and allocates again on its next insert.
+     * @param other Hashmap to move
+     */
+    HashMap (HashMap && other) noexcept : _capacity (other._capacity) , _size (other._size) ,
+                                          loadFactor (other.loadFactor) ,
+                                          upFactor (other.upFactor) , map (other.map) ,
+                                          oldMap (other.oldMap) , oldCapacity (other.oldCapacity) ,
+                                          migrated (other.migrated) ,
+                                          incremental (other.incremental) ,
+                                          autoShrink (other.autoShrink) ,
+                                          hasher (std::move (other.hasher)) ,
+                                          equal (std::move (other.equal)) ,
+                                          allocator (other.allocator)
+    {
+        other.map = nullptr;
+        other.oldMap = nullptr;
+        other._capacity = 0;
+        other._size = STARTING_SIZE;
+        other.oldCapacity = 0;
+        other.migrated = 0;
+    }
+
+    /**
+     * Move Constcutor into the given allocator, takes the buckets of the other map if the
+     * allocators are equal and moves the pairs one by one otherwise
+     * @param other Hashmap to move
+     * @param alloc Allocator of the new map
+     */
+    HashMap (HashMap && other , const Allocator & alloc) : HashMap (other.hasher , other.equal ,
+                                                                    alloc)
+    {
+        loadFactor = other.loadFactor;
+        upFactor = other.upFactor;
+        incremental = other.incremental;
+        autoShrink = other.autoShrink;
+        if (allocator == other.allocator)
+        {
+            _exchange (other);
+            return;
+        }
+        reserve (other._size);
+        other._migrate (other.oldCapacity);
+        for (int i = 0 ; i < other._capacity ; ++ i)
         {
             for (auto j = other.map[i].begin () ; j != other.map[i].end () ; ++ j)
             {
-                map[i].push_back (*j);
+                int bucket = _bucketOf (j->hashOf (hasher));
+                map[bucket].push_back (std::move (*j));
+                _mark (map , _capacity , bucket);
             }
         }
+        _size = other._size;
+        other.clear ();
     }
 
     /**
@@ -119,7 +628,164 @@ public:
      */
     ~HashMap ()
     {
-        delete[]map;
+        _free (map , _capacity);
+        _free (oldMap , oldCapacity);
+    }
+
+    /**
+     * Allocator of the map
+     * @return Copy of the allocator
+     */
+    Allocator get_allocator () const
+    {
+        return allocator;
+    }
+
+    /**
+     * Turns the incremental rehash mode on or off, turning it off finishes a running migration
+     * @param enable true for incremental resizes, false for resizes that move everything at once
+     */
+    void setIncrementalRehash (bool enable)
+    {
+        incremental = enable;
+        if (! enable)
+        {
+            _migrate (oldCapacity);
+        }
+    }
+
+    /**
+     * Checks if an incremental resize is still migrating buckets
+     * @return true if migrating false otherwise
+     */
+    bool rehashing () const
+    {
+        return oldMap != nullptr;
+    }
+
+    /**
+     * Sets the load factors the map resizes at
+     * @param lower Load factor under which erase shrinks the map, 0 to never shrink
+     * @param upper Load factor over which insert grows the map
+     * Throws sizeException unless 0 <= lower < upper / CAPACITY_CHANGE
+     */
+    void setLoadFactors (double lower , double upper)
+    {
+        if (! (lower >= 0 && upper > 0 && lower * CAPACITY_CHANGE < upper))
+        {
+            throw sizeException ();
+        }
+        loadFactor = lower;
+        upFactor = upper;
+    }
+
+    /**
+     * Lower load factor
+     * @return Load factor under which erase shrinks the map
+     */
+    double getMinLoadFactor () const
+    {
+        return loadFactor;
+    }
+
+    /**
+     * Upper load factor
+     * @return Load factor over which insert grows the map
+     */
+    double getMaxLoadFactor () const
+    {
+        return upFactor;
+    }
+
+    /**
+     * Turns shrinking on erase on or off, e.g. off for a bulk delete followed by one
+     * shrink_to_fit. Turning it back on shrinks the map if it is under the lower load factor.
+     * @param enable true to shrink on erase false otherwise
+     */
+    void setAutoShrink (bool enable)
+    {
+        autoShrink = enable;
+        if (enable)
+        {
+            _shrink ();
+        }
+    }
+
+    /**
+     * Grows the map so the given amount of elements fits without another resize
+     * @param amount Amount of elements
+     */
+    void reserve (int amount)
+    {
+        int newCapacity = _fitting (amount);
+        if (newCapacity > _capacity)
+        {
+            _rehash (newCapacity);
+        }
+    }
+
+    /**
+     * Resizes the map to at least the given capacity, rounded up to a power of CAPACITY_CHANGE
+     * and never under what the current elements need
+     * @param count Requested capacity
+     */
+    void rehash (int count)
+    {
+        int newCapacity = _fitting (_size);
+        while (newCapacity < count)
+        {
+            newCapacity *= CAPACITY_CHANGE;
+        }
+        if (newCapacity != _capacity || oldMap != nullptr)
+        {
+            _rehash (newCapacity);
+        }
+    }
+
+    /**
+     * Shrinks the map to the smallest capacity that holds the current elements
+     */
+    void shrink_to_fit ()
+    {
+        rehash (0);
+    }
+
+    /**
+     * Inserts or assigns a range of pairs, a later pair overrides an earlier one with the same
+     * key. The map is resized once up front when the length of the range is known, and
+     * PARALLEL_BUILD pairs or more are spread over threads that each own a slice of the buckets,
+     * when the allocator is stateless.
+     * @tparam InputIt type of the iterators
+     * @param first Start of the range
+     * @param last End of the range
+     * @param threads Amount of threads, 0 for one per hardware thread
+     */
+    template<typename InputIt>
+    void bulk_insert (InputIt first , InputIt last , unsigned int threads = 0)
+    {
+        typedef typename std::iterator_traits<InputIt>::iterator_category category;
+        if constexpr (! std::is_base_of<std::forward_iterator_tag , category>::value)
+        {
+            for ( ; first != last ; ++ first)
+            {
+                auto && entry = *first;
+                insert_or_assign (std::forward<decltype (entry)> (entry).first ,
+                                  std::forward<decltype (entry)> (entry).second);
+            }
+        }
+        else
+        {
+            std::vector<InputIt> items;
+            items.reserve ((size_t) std::distance (first , last));
+            for ( ; first != last ; ++ first)
+            {
+                items.push_back (first);
+            }
+            _bulkInsert (items.size () , [&items] (size_t i) -> decltype (auto)
+            {
+                return *items[i];
+            } , threads);
+        }
     }
 
     /**
@@ -128,30 +794,100 @@ public:
      * @param value Value to insert
      * @return true if inserted false otherwise
      */
-    bool insert (KeyT key , ValueT value)
+    template<typename K = KeyT , typename V = ValueT>
+    bool insert (K && key , V && value)
     {
-        if (containsKey (key))
+        return insert_or_assign (std::forward<K> (key) , std::forward<V> (value)).second;
+    }
+
+    /**
+     * Finds the given key, string keyed maps can be probed with any string like type
+     * @param key Key to find
+     * @return Iterator to the pair of the key, end () if missing
+     */
+    template<typename K = KeyT>
+    const_iterator find (const K & key) const
+    {
+        const lookup_type<K> & probe = key;
+        int bucket;
+        size_t hash = hasher (probe);
+        Bucket *table = _tableOf (hash , bucket);
+        int index = _probe (table , bucket , hash , probe);
+        if (index == - 1)
         {
-            int final = std::hash<KeyT> {} (key) & (_capacity - 1);
-            for (auto i = map[final].begin () ; i != map[final].end () ; ++ i)
-            {
-                if ((*i).first == key)
-                {
-                    (*i).second = value;
-                    return false;
-                }
-            }
-            return false;
+            return end ();
         }
-        if ((_size + 1) > upFactor * _capacity)
+        return _iteratorAt (table , bucket , index);
+    }
+
+    /**
+     * Inserts the key with a value constructed from the arguments, if the key is missing
+     * @param key Key to insert
+     * @param args Arguments for the value
+     * @return Iterator to the pair of the key, and true if inserted false if already there
+     */
+    template<typename... Args>
+    std::pair<const_iterator , bool> try_emplace (const KeyT & key , Args && ... args)
+    {
+        return _tryEmplace (key , std::forward<Args> (args)...);
+    }
+
+    /**
+     * Inserts the key with a value constructed from the arguments, if the key is missing
+     * @param key Key to insert, moved from only if inserted
+     * @param args Arguments for the value
+     * @return Iterator to the pair of the key, and true if inserted false if already there
+     */
+    template<typename... Args>
+    std::pair<const_iterator , bool> try_emplace (KeyT && key , Args && ... args)
+    {
+        return _tryEmplace (std::move (key) , std::forward<Args> (args)...);
+    }
+
+    /**
+     * Inserts the key with the value, or assigns the value if the key is already there
+     * @param key Key to insert
+     * @param value Value to insert or assign
+     * @return Iterator to the pair of the key, and true if inserted false if assigned
+     */
+    template<typename V>
+    std::pair<const_iterator , bool> insert_or_assign (const KeyT & key , V && value)
+    {
+        auto result = _tryEmplace (key , std::forward<V> (value));
+        if (! result.second)
         {
-            _rehash (_capacity * CAPACITY_CHANGE);
+            result.first._pair ().second = std::forward<V> (value);
         }
-        int final = std::hash<KeyT> {} (key) & (_capacity - 1);
-        map[final].push_back (std::make_pair (key , value));
-        ++ _size;
-        return true;
+        return result;
+    }
+
+    /**
+     * Inserts the key with the value, or assigns the value if the key is already there
+     * @param key Key to insert, moved from only if inserted
+     * @param value Value to insert or assign
+     * @return Iterator to the pair of the key, and true if inserted false if assigned
+     */
+    template<typename V>
+    std::pair<const_iterator , bool> insert_or_assign (KeyT && key , V && value)
+    {
+        auto result = _tryEmplace (std::move (key) , std::forward<V> (value));
+        if (! result.second)
+        {
+            result.first._pair ().second = std::forward<V> (value);
+        }
+        return result;
+    }
 
+    /**
+     * Constructs a pair from the arguments and inserts it if its key is missing
+     * @param args Arguments for the pair
+     * @return Iterator to the pair of the key, and true if inserted false if already there
+     */
+    template<typename... Args>
+    std::pair<const_iterator , bool> emplace (Args && ... args)
+    {
+        std::pair<KeyT , ValueT> pair (std::forward<Args> (args)...);
+        return _tryEmplace (std::move (pair.first) , std::move (pair.second));
     }
 
     /**
@@ -159,11 +895,17 @@ public:
      */
     void clear ()
     {
+        _free (oldMap , oldCapacity);
+        oldMap = nullptr;
         for (int i = 0 ; i < _capacity ; ++ i)
         {
-            _size -= map[i].size ();
             map[i].clear ();
         }
+        if (_capacity > 0)
+        {
+            std::memset (_occupancy (map , _capacity) , 0 , _words (_capacity) * sizeof (uint64_t));
+        }
+        _size = STARTING_SIZE;
     }
 
     /**
@@ -171,20 +913,10 @@ public:
      * @param key Key to check
      * @return true if contains false otherwise
      */
-    bool containsKey (KeyT key) const
+    template<typename K = KeyT>
+    bool containsKey (const K & key) const
     {
-        int firstIndex = std::hash<KeyT> {} (key);
-        int finalIndex = firstIndex & (_capacity - 1);
-        for (auto i = map[finalIndex].begin () ; i != map[finalIndex].end () ; ++ i)
-        {
-            std::pair<KeyT , ValueT> temp = *i;
-            if (temp.first == key)
-            {
-                return true;
-            }
-        }
-        return false;
-
+        return find (key) != end ();
     }
 
     /**
@@ -201,27 +933,34 @@ public:
      * @param key Key to earse
      * @return true if erased false otherwise
      */
-    bool erase (KeyT key)
+    template<typename K = KeyT>
+    bool erase (const K & key)
     {
         if (empty ())
         {
             return false;
         }
-        int index = std::hash<KeyT> {} (key) & (_capacity - 1);
-        for (auto i = map[index].begin () ; i != map[index].end () ; ++ i)
+        _migrate (REHASH_STEP);
+        const lookup_type<K> & probe = key;
+        int bucket;
+        size_t hash = hasher (probe);
+        Bucket *table = _tableOf (hash , bucket);
+        int index = _probe (table , bucket , hash , probe);
+        if (index == - 1)
         {
-            if ((*i).first == key)
-            {
-                map[index].erase (i);
-                -- _size;
-                while (_capacity > 0 && getLoadFactor () < loadFactor)
-                {
-                    _rehash (_capacity / CAPACITY_CHANGE);
-                }
-                return true;
-            }
+            return false;
         }
-        return false;
+        table[bucket].erase (table[bucket].begin () + index);
+        if (table[bucket].empty ())
+        {
+            _unmark (table , table == oldMap ? oldCapacity : _capacity , bucket);
+        }
+        -- _size;
+        if (autoShrink)
+        {
+            _shrink ();
+        }
+        return true;
     }
 
     /**
@@ -230,7 +969,7 @@ public:
      */
     double getLoadFactor () const
     {
-        return (double) _size / _capacity;
+        return _capacity == 0 ? 0 : (double) _size / _capacity;
     }
 
     /**
@@ -238,10 +977,18 @@ public:
      * @param key Key to check
      * @return size of the bucket
      */
-    int bucketSize (KeyT key) const
+    template<typename K = KeyT>
+    int bucketSize (const K & key) const
     {
-        int index = bucketIndex (key);
-        return map[index].capacity ();
+        const lookup_type<K> & probe = key;
+        int bucket;
+        size_t hash = hasher (probe);
+        Bucket *table = _tableOf (hash , bucket);
+        if (_probe (table , bucket , hash , probe) == - 1)
+        {
+            throw indexException {};
+        }
+        return table[bucket].capacity ();
     }
 
     /**
@@ -249,16 +996,18 @@ public:
      * @param key Key to check
      * @return Index of the bucket for the given key
      */
-    int bucketIndex (KeyT key) const
+    template<typename K = KeyT>
+    int bucketIndex (const K & key) const
     {
-        if (containsKey (key))
-        {
-            return (std::hash<KeyT> {} (key) & (_capacity - 1));
-        }
-        else
+        const lookup_type<K> & probe = key;
+        int bucket;
+        size_t hash = hasher (probe);
+        Bucket *table = _tableOf (hash , bucket);
+        if (_probe (table , bucket , hash , probe) == - 1)
         {
             throw indexException {};
         }
+        return bucket;
     }
 
     /**
@@ -268,34 +1017,32 @@ public:
  */
     ValueT & operator[] (const KeyT & key)
     {
-        try
-        {
-            return at (key);
+        return try_emplace (key).first._pair ().second;
+    }
 
-        }
-        catch (indexException & e)
-        {
-            insert (key , ValueT {});
-            return at (key);
-        }
+    /**
+ * returns the value of the given key
+ * @param key Key to return its value, moved from only if inserted
+ * @return ValueT of the given key
+ */
+    ValueT & operator[] (KeyT && key)
+    {
+        return try_emplace (std::move (key)).first._pair ().second;
     }
 
     /**
-     * return the value of the given key if its in the map 0 otherwise
+     * return the value of the given key if its in the map default value otherwise
      * @param key Key whose ValueT to return
-     * @return the value of the given key if its in the map 0 otherwise
+     * @return the value of the given key if its in the map default value otherwise
      */
-    ValueT & operator[] (const KeyT & key) const
+    ValueT operator[] (const KeyT & key) const
     {
-        try
+        const_iterator found = find (key);
+        if (found == end ())
         {
-            return at (key);
-
-        }
-        catch (indexException & e)
-        {
-            return 0;
+            return ValueT {};
         }
+        return found->second;
     }
 
     /**
@@ -321,49 +1068,104 @@ public:
      * @param key Key to check
      * @return ValueT if key exists indexException otherwise
      */
-    ValueT & at (KeyT key) const
+    template<typename K = KeyT>
+    ValueT & at (const K & key)
     {
-        try
+        const_iterator found = find (key);
+        if (found == end ())
         {
-            int index = bucketIndex (key);
-            for (int i = 0 ; i < (int) map[index].capacity () ; ++ i)
-            {
-                if (map[index].at (i).first == key)
-                {
-                    return map[index].at (i).second;
+            throw indexException {};
+        }
+        return found._pair ().second;
+    }
 
-                }
-            }
-            return map[index].at (0).second;
+    /**
+     * return the ValueT of the given key,if doesnt exist throw exception
+     * @param key Key to check
+     * @return ValueT if key exists indexException otherwise
+     */
+    template<typename K = KeyT>
+    const ValueT & at (const K & key) const
+    {
+        const_iterator found = find (key);
+        if (found == end ())
+        {
+            throw indexException {};
+        }
+        return found->second;
+    }
+
+    /**
+     * copies the map
+     * @param other map to copy
+     * @return HashMap of the copied map
+     */
+    HashMap & operator= (const HashMap & other)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+        constexpr bool propagate = AllocTraits::propagate_on_container_copy_assignment::value;
+        HashMap copy (other , propagate ? other.allocator : allocator);
+        _exchange (copy);
+        if constexpr (propagate)
+        {
+            std::swap (allocator , copy.allocator);
+        }
+        return *this;
+    }
+
+    /**
+     * Moves the map. The buckets are taken over when the allocator propagates or the allocators
+     * are equal, otherwise the pairs are moved into this map's allocator one by one.
+     * @param other map to move, left empty
+     * @return This map
+     */
+    HashMap & operator= (HashMap && other) noexcept (
+            AllocTraits::propagate_on_container_move_assignment::value ||
+            AllocTraits::is_always_equal::value)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+        if constexpr (AllocTraits::propagate_on_container_move_assignment::value)
+        {
+            HashMap moved (std::move (other));
+            _exchange (moved);
+            std::swap (allocator , moved.allocator);
         }
-        catch (indexException & e)
+        else
         {
-            throw indexException {};
+            HashMap moved (std::move (other) , allocator);
+            _exchange (moved);
         }
-
+        return *this;
     }
 
     /**
-     * copies the map
-     * @param other map to copy
-     * @return HashMap of the copied map
+     * Exchanges the contents and the settings of the maps without copying any element. The
+     * allocators are exchanged only if they propagate on swap, otherwise they must be equal.
+     * @param other map to exchange with
      */
-    HashMap & operator= (const HashMap & other)
+    void swap (HashMap & other) noexcept
     {
-        if (this == &other)
-        {
-            return *this;
-        }
-        delete[]map;
-        map = new std::vector<std::pair<KeyT , ValueT>>[other._capacity];
-        _size = other._size;
-        _capacity = other._capacity;
-        for (int i = 0 ; i < _capacity ; ++ i)
+        _exchange (other);
+        if constexpr (AllocTraits::propagate_on_container_swap::value)
         {
-            map[i] = other.map[i];
+            std::swap (allocator , other.allocator);
         }
+    }
 
-        return *this;
+    /**
+     * Exchanges the contents of the maps
+     * @param first first map
+     * @param second second map
+     */
+    friend void swap (HashMap & first , HashMap & second) noexcept
+    {
+        first.swap (second);
     }
 
     /**
@@ -377,10 +1179,10 @@ public:
         {
             return false;
         }
-        for (int i = 0 ; i < _capacity ; ++ i)
+        for (auto i = begin () ; i != end () ; ++ i)
         {
-
-            if (map[i] != other.map[i])
+            const_iterator found = other.find (i->first);
+            if (found == other.end () || ! (found->second == i->second))
             {
                 return false;
             }
@@ -395,18 +1197,7 @@ public:
      */
     bool operator!= (const HashMap & other) const
     {
-        if (_size != other._size)
-        {
-            return true;
-        }
-        for (int i = 0 ; i < _capacity ; ++ i)
-        {
-            if (map[i] != other.map[i])
-            {
-                return true;
-            }
-        }
-        return false;
+        return ! (*this == other);
     }
 
     /**
@@ -417,8 +1208,8 @@ public:
     public:
         typedef int difference_type;
         typedef std::pair<KeyT , ValueT> value_type;
-        typedef std::pair<KeyT , ValueT> *pointer;
-        typedef std::pair<KeyT , ValueT> & reference;
+        typedef const std::pair<KeyT , ValueT> *pointer;
+        typedef const std::pair<KeyT , ValueT> & reference;
         typedef std::forward_iterator_tag iterator_category;
 
         /**
@@ -426,46 +1217,30 @@ public:
          * @param now Map to represent the Hashmap
          * @param bucketNum Starting bucket position
          * @param index Starting index inside the bucket
-         * @param pair Current pair
+         * @param pair Current pair, nullptr to start at the first pair from bucketNum on
          * @param size Current amount of elements
+         * @param next Bucket array to continue with once now is done, nullptr if none
+         * @param nextSize Amount of buckets in next
          */
-        const_iterator (std::vector<std::pair<KeyT , ValueT> > *now = nullptr , int bucketNum = 0 ,
-                        int index = 0 , pointer pair = nullptr , int size = 0) : hashMap (now) ,
-                                                                                 bucketNum (
-                                                                                         bucketNum) ,
-                                                                                 indexInBucket (
-                                                                                         index) ,
-                                                                                 cur (pair) ,
-                                                                                 _mySize (size)
-        {
-        };
-
-        /**
-         * copies the ierator
-         * @param constIterator other iterator to copy
-         * @return New iterator
-         */
-        const_iterator & operator= (const const_iterator & constIterator)
+        const_iterator (Bucket *now = nullptr , int bucketNum = 0 ,
+                        int index = 0 , std::pair<KeyT , ValueT> *pair = nullptr , int size = 0 ,
+                        Bucket *next = nullptr , int nextSize = 0) :
+                hashMap (now) , bucketNum (bucketNum) , indexInBucket (index) , cur (pair) ,
+                _mySize (size) , nextMap (next) , _nextSize (nextSize)
         {
-            if (this == &constIterator)
+            if (hashMap != nullptr && cur == nullptr && _skipEmpty ())
             {
-                return *this;
+                cur = &(hashMap[this->bucketNum].at (indexInBucket));
             }
-            cur->first = constIterator.cur->first;
-            cur->second = constIterator.cur->second;
-            bucketNum = constIterator.bucketNum;
-            indexInBucket = constIterator.indexInBucket;
-            hashMap = constIterator.hashMap;
-            return *this;
-        }
+        };
 
         /**
-         * return the valueT of the current pair
-         * @return valueT of the current pair
+         * return the current pair
+         * @return current pair
          */
-        value_type operator* ()
+        reference operator* () const
         {
-            return value_type (cur->first , cur->second);
+            return *cur;
         }
 
         /**
@@ -490,10 +1265,8 @@ public:
             else
             {
                 bucketNum ++;
-                while (bucketNum < _mySize && hashMap[bucketNum].size () == 0)
-                { bucketNum ++; }
                 indexInBucket = 0;
-                if (bucketNum > _mySize - 1)
+                if (! _skipEmpty ())
                 {
                     cur = nullptr;
                     return *this;
@@ -536,11 +1309,62 @@ public:
         }
 
     private:
-        std::vector<std::pair<KeyT , ValueT> > *hashMap;
+        friend class HashMap;
+
+        Bucket *hashMap;
         int bucketNum;
         unsigned int indexInBucket;
-        pointer cur;
+        std::pair<KeyT , ValueT> *cur;
         int _mySize;
+        Bucket *nextMap;
+        int _nextSize;
+
+        /**
+         * The current pair as stored, for the writes of the map through an iterator it returned
+         * @return current pair
+         */
+        std::pair<KeyT , ValueT> & _pair () const
+        {
+            return *cur;
+        }
+
+        /**
+         * Moves to the first non empty bucket from bucketNum on, continuing into the next bucket
+         * array when the current one is done. Whole words of the occupancy bitmap are skipped at
+         * once, so a sparse map is not walked bucket by bucket.
+         * @return true if a pair was found false at the end
+         */
+        bool _skipEmpty ()
+        {
+            while (true)
+            {
+                if (bucketNum < _mySize)
+                {
+                    const uint64_t *bits = _occupancy (hashMap , _mySize);
+                    int word = bucketNum / OCCUPANCY_BITS;
+                    int words = (int) _words (_mySize);
+                    uint64_t pending = bits[word] & (~0ULL << (bucketNum % OCCUPANCY_BITS));
+                    while (pending == 0 && ++ word < words)
+                    {
+                        pending = bits[word];
+                    }
+                    if (pending != 0)
+                    {
+                        bucketNum = word * OCCUPANCY_BITS + __builtin_ctzll (pending);
+                        return true;
+                    }
+                    bucketNum = _mySize;
+                }
+                if (nextMap == nullptr)
+                {
+                    return false;
+                }
+                hashMap = nextMap;
+                _mySize = _nextSize;
+                nextMap = nullptr;
+                bucketNum = 0;
+            }
+        }
     };
 
     /**
@@ -549,17 +1373,12 @@ public:
      */
     const_iterator begin () const
     {
-        int i = 0;
-        while (i < this->_capacity && map[i].size () == 0)
+        if (oldMap != nullptr)
         {
-            ++ i;
+            return _settle (const_iterator (oldMap , migrated , 0 , nullptr , oldCapacity , map ,
+                                             _capacity));
         }
-        if (i == capacity ())
-        {
-            return const_iterator (nullptr);
-        }
-        const_iterator temp = const_iterator (this->map , i , 0 , &map[i].at (0) , capacity ());
-        return temp;
+        return _settle (const_iterator (map , 0 , 0 , nullptr , _capacity));
     }
 
     /**
@@ -568,17 +1387,7 @@ public:
       */
     const_iterator cbegin () const
     {
-        int i = 0;
-        while (i < capacity () && map[i].size () == 0)
-        {
-            ++ i;
-        }
-        if (i == capacity ())
-        {
-            return const_iterator (nullptr);
-        }
-        const_iterator temp = const_iterator (this->map , i , 0 , &map[i].at (0) , capacity ());
-        return temp;
+        return begin ();
     }
 
     /**
@@ -600,6 +1409,14 @@ public:
     }
 
 private:
+    /**
+     * Type a key of type K is probed as, K itself if the hash and the equality are both
+     * transparent, KeyT otherwise
+     */
+    template<typename K>
+    using lookup_type = typename std::conditional<
+            isTransparent<Hash>::value && isTransparent<KeyEqual>::value , K , KeyT>::type;
+
     /**
      * current capacity
      */
@@ -615,7 +1432,487 @@ private:
     /**
      * map to represent the Hashmap
      */
-    std::vector<std::pair<KeyT , ValueT> > *map;
+    Bucket *map;
+    /**
+     * bucket array an incremental resize is migrating from, nullptr if none
+     */
+    Bucket *oldMap;
+    /**
+     * amount of buckets in oldMap
+     */
+    int oldCapacity;
+    /**
+     * buckets of oldMap below this index are already migrated
+     */
+    int migrated;
+    /**
+     * true if resizes are incremental
+     */
+    bool incremental;
+    /**
+     * true if erase shrinks the map
+     */
+    bool autoShrink;
+    /**
+     * hash of the keys
+     */
+    Hash hasher;
+    /**
+     * equality of the keys
+     */
+    KeyEqual equal;
+    /**
+     * allocator of the map
+     */
+    Allocator allocator;
+
+    /**
+     * Exchanges everything but the allocators
+     * @param other map to exchange with
+     */
+    void _exchange (HashMap & other) noexcept
+    {
+        std::swap (_capacity , other._capacity);
+        std::swap (_size , other._size);
+        std::swap (loadFactor , other.loadFactor);
+        std::swap (upFactor , other.upFactor);
+        std::swap (map , other.map);
+        std::swap (oldMap , other.oldMap);
+        std::swap (oldCapacity , other.oldCapacity);
+        std::swap (migrated , other.migrated);
+        std::swap (incremental , other.incremental);
+        std::swap (autoShrink , other.autoShrink);
+        std::swap (hasher , other.hasher);
+        std::swap (equal , other.equal);
+    }
+
+    /**
+     * Allocates a bucket array of empty buckets. The buckets are built in place with the
+     * allocator of the map, not through the allocator, since uses allocator construction would
+     * hand them the allocator a second time.
+     * @param capacity Amount of buckets
+     * @return The bucket array
+     */
+    Bucket *_allocate (int capacity)
+    {
+        BucketAllocator buckets (allocator);
+        Bucket *array = BucketTraits::allocate (buckets , (size_t) capacity + _tail (capacity));
+        for (int i = 0 ; i < capacity ; ++ i)
+        {
+            ::new ((void *) (array + i)) Bucket (EntryAllocator (allocator));
+        }
+        std::memset ((void *) _occupancy (array , capacity) , 0 ,
+                     _words (capacity) * sizeof (uint64_t));
+        return array;
+    }
+
+    /**
+     * Destroys and frees a bucket array
+     * @param array Bucket array, may be nullptr
+     * @param capacity Amount of buckets
+     */
+    void _free (Bucket *array , int capacity)
+    {
+        if (array == nullptr)
+        {
+            return;
+        }
+        BucketAllocator buckets (allocator);
+        for (int i = 0 ; i < capacity ; ++ i)
+        {
+            array[i].~Bucket ();
+        }
+        BucketTraits::deallocate (buckets , array , (size_t) capacity + _tail (capacity));
+    }
+
+    /**
+     * Amount of words in the occupancy bitmap of a bucket array
+     * @param capacity Amount of buckets
+     * @return Amount of words, one bit per bucket
+     */
+    static size_t _words (int capacity)
+    {
+        return ((size_t) capacity + OCCUPANCY_BITS - 1) / OCCUPANCY_BITS;
+    }
+
+    /**
+     * Amount of bucket sized cells after the buckets of an array that hold its bitmap
+     * @param capacity Amount of buckets
+     * @return Amount of cells
+     */
+    static size_t _tail (int capacity)
+    {
+        return (_words (capacity) * sizeof (uint64_t) + sizeof (Bucket) - 1) / sizeof (Bucket);
+    }
+
+    /**
+     * Occupancy bitmap of a bucket array, stored right after its buckets in the same allocation,
+     * bit i is set while bucket i is not empty
+     * @param array Bucket array
+     * @param capacity Amount of buckets
+     * @return The bitmap
+     */
+    static uint64_t *_occupancy (Bucket *array , int capacity)
+    {
+        static_assert (alignof (Bucket) >= alignof (uint64_t) , "bitmap after the buckets");
+        return reinterpret_cast<uint64_t *> (array + capacity);
+    }
+
+    /**
+     * Marks a bucket as not empty
+     * @param array Bucket array of the bucket
+     * @param capacity Amount of buckets in the array
+     * @param bucket The bucket
+     */
+    static void _mark (Bucket *array , int capacity , int bucket)
+    {
+        _occupancy (array , capacity)[bucket / OCCUPANCY_BITS] |= 1ULL << (bucket % OCCUPANCY_BITS);
+    }
+
+    /**
+     * Marks a bucket as empty
+     * @param array Bucket array of the bucket
+     * @param capacity Amount of buckets in the array
+     * @param bucket The bucket
+     */
+    static void _unmark (Bucket *array , int capacity , int bucket)
+    {
+        _occupancy (array , capacity)[bucket / OCCUPANCY_BITS] &=
+                ~(1ULL << (bucket % OCCUPANCY_BITS));
+    }
+
+    /**
+     * Bucket of the given hash
+     * @param hash Hash of a key
+     * @return Index of the bucket
+     */
+    int _bucketOf (size_t hash) const
+    {
+        return (int) (hash & (size_t) (_capacity - 1));
+    }
+
+    /**
+     * Bucket array and bucket holding the given hash, the old array if the bucket of the hash
+     * there was not migrated yet
+     * @param hash Hash of a key
+     * @param bucket Set to the index of the bucket
+     * @return Bucket array of the bucket
+     */
+    Bucket *_tableOf (size_t hash , int & bucket) const
+    {
+        if (oldMap != nullptr)
+        {
+            bucket = (int) (hash & (size_t) (oldCapacity - 1));
+            if (bucket >= migrated)
+            {
+                return oldMap;
+            }
+        }
+        bucket = _bucketOf (hash);
+        return map;
+    }
+
+    /**
+     * Turns a default constructed iterator into the end iterator
+     * @param iterator Iterator to check
+     * @return The iterator, or end () if it has no pair
+     */
+    const_iterator _settle (const const_iterator & iterator) const
+    {
+        return iterator.operator-> () == nullptr ? end () : iterator;
+    }
+
+    /**
+     * Scans the bucket for the key
+     * @param table Bucket array of the bucket
+     * @param bucket Bucket to scan
+     * @param hash Hash of the key
+     * @param key Key to look for
+     * @return Index of the key inside the bucket, -1 if missing
+     */
+    template<typename K>
+    int _probe (const Bucket *table , int bucket , size_t hash , const K & key) const
+    {
+        if (table == nullptr)
+        {
+            return - 1;
+        }
+        const Bucket & chain = table[bucket];
+        for (int i = 0 ; i < (int) chain.size () ; ++ i)
+        {
+            if (chain[i].sameHash (hash) && equal (chain[i].first , key))
+            {
+                return i;
+            }
+        }
+        return - 1;
+    }
+
+    /**
+     * Iterator to a pair inside a bucket
+     * @param table Bucket array of the bucket
+     * @param bucket Bucket of the pair
+     * @param index Index of the pair inside the bucket
+     * @return Iterator to the pair
+     */
+    const_iterator _iteratorAt (Bucket *table , int bucket ,
+                                int index) const
+    {
+        if (table == oldMap)
+        {
+            return const_iterator (table , bucket , index , &table[bucket][index] , oldCapacity ,
+                                   map , _capacity);
+        }
+        return const_iterator (table , bucket , index , &table[bucket][index] , _capacity);
+    }
+
+    /**
+     * Hashes the key once and scans its bucket once, on a miss the pair is constructed in
+     * place, after growing the map if needed
+     * @param key Key to insert
+     * @param args Arguments for the value
+     * @return Iterator to the pair of the key, and true if inserted false if already there
+     */
+    template<typename K , typename... Args>
+    std::pair<const_iterator , bool> _tryEmplace (K && key , Args && ... args)
+    {
+        _migrate (REHASH_STEP);
+        size_t hash = hasher (key);
+        int bucket;
+        Bucket *table = _tableOf (hash , bucket);
+        int index = _probe (table , bucket , hash , key);
+        if (index != - 1)
+        {
+            return std::make_pair (_iteratorAt (table , bucket , index) , false);
+        }
+        if ((_size + 1) > upFactor * _capacity)
+        {
+            int newCapacity = _capacity > 0 ? _capacity : 1;
+            while ((_size + 1) > upFactor * newCapacity)
+            {
+                newCapacity *= CAPACITY_CHANGE;
+            }
+            _resize (newCapacity);
+            table = _tableOf (hash , bucket);
+        }
+        table[bucket].emplace_back (hash , std::piecewise_construct ,
+                                    std::forward_as_tuple (std::forward<K> (key)) ,
+                                    std::forward_as_tuple (std::forward<Args> (args)...));
+        _mark (table , table == oldMap ? oldCapacity : _capacity , bucket);
+        ++ _size;
+        return std::make_pair (_iteratorAt (table , bucket , (int) table[bucket].size () - 1) , true);
+    }
+
+    /**
+     * Inserts or assigns amount pairs in one resize. Every pair is hashed once, then each thread
+     * walks the hashes and fills only the buckets of its own slice, in input order, so no bucket
+     * is shared between threads and the last pair of a key still wins. Slices are whole words of
+     * the occupancy bitmap, so no bitmap word is shared either.
+     * @tparam Get type of the accessor
+     * @param amount Amount of pairs
+     * @param get Returns the i'th pair
+     * @param threads Amount of threads, 0 for one per hardware thread
+     */
+    template<typename Get>
+    void _bulkInsert (size_t amount , Get get , unsigned int threads)
+    {
+        reserve ((int) (_size + amount));
+        _migrate (oldCapacity);
+        if (threads == 0)
+        {
+            threads = std::thread::hardware_concurrency ();
+        }
+        // a stateful allocator, e.g. a monotonic arena, is not safe to share between threads
+        if (amount < PARALLEL_BUILD || threads <= 1 || ! AllocTraits::is_always_equal::value)
+        {
+            for (size_t i = 0 ; i < amount ; ++ i)
+            {
+                auto && entry = get (i);
+                if (_store (hasher (entry.first) , std::forward<decltype (entry)> (entry)))
+                {
+                    ++ _size;
+                }
+            }
+            return;
+        }
+        std::vector<size_t> hashes (amount);
+        std::vector<size_t> added (threads , 0);
+        std::vector<std::exception_ptr> errors (threads);
+        std::vector<std::thread> workers;
+        auto run = [&errors , &workers , threads] (const std::function<void (unsigned int)> & work)
+        {
+            for (unsigned int t = 0 ; t < threads ; ++ t)
+            {
+                workers.emplace_back ([&work , &errors , t] ()
+                                      {
+                                          try
+                                          {
+                                              work (t);
+                                          }
+                                          catch (...)
+                                          {
+                                              errors[t] = std::current_exception ();
+                                          }
+                                      });
+            }
+            for (auto & worker : workers)
+            {
+                worker.join ();
+            }
+            workers.clear ();
+            for (auto & error : errors)
+            {
+                if (error != nullptr)
+                {
+                    std::rethrow_exception (error);
+                }
+            }
+        };
+        // a failed hash throws here, before anything is stored with a hash that was never set
+        run ([&] (unsigned int t)
+             {
+                 for (size_t i = amount * t / threads ; i < amount * (t + 1) / threads ; ++ i)
+                 {
+                     hashes[i] = hasher (get (i).first);
+                 }
+             });
+        std::exception_ptr failure;
+        try
+        {
+            run ([&] (unsigned int t)
+                 {
+                     size_t words = _words (_capacity);
+                     size_t low = words * t / threads * OCCUPANCY_BITS;
+                     size_t high = words * (t + 1) / threads * OCCUPANCY_BITS;
+                     for (size_t i = 0 ; i < amount ; ++ i)
+                     {
+                         size_t bucket = (size_t) _bucketOf (hashes[i]);
+                         if (bucket >= low && bucket < high)
+                         {
+                             added[t] += _store (hashes[i] , get (i)) ? 1 : 0;
+                         }
+                     }
+                 });
+        }
+        catch (...)
+        {
+            failure = std::current_exception ();
+        }
+        // the pairs stored before a failure stay counted, so the map is consistent if it throws
+        for (unsigned int t = 0 ; t < threads ; ++ t)
+        {
+            _size += (int) added[t];
+        }
+        if (failure != nullptr)
+        {
+            std::rethrow_exception (failure);
+        }
+    }
+
+    /**
+     * Assigns the pair to its key, or appends it to its bucket if the key is new. Touches only
+     * the bucket of the hash and never resizes.
+     * @tparam Pair type of the pair
+     * @param hash Hash of the key
+     * @param entry Pair to store
+     * @return true if the key is new false otherwise
+     */
+    template<typename Pair>
+    bool _store (size_t hash , Pair && entry)
+    {
+        int bucket = _bucketOf (hash);
+        int index = _probe (map , bucket , hash , entry.first);
+        if (index != - 1)
+        {
+            map[bucket][index].second = std::forward<Pair> (entry).second;
+            return false;
+        }
+        map[bucket].emplace_back (hash , std::piecewise_construct ,
+                                  std::forward_as_tuple (std::forward<Pair> (entry).first) ,
+                                  std::forward_as_tuple (std::forward<Pair> (entry).second));
+        _mark (map , _capacity , bucket);
+        return true;
+    }
+
+    /**
+     * Smallest capacity that holds the given amount of elements under the upper load factor
+     * @param amount Amount of elements
+     * @return The capacity, a power of CAPACITY_CHANGE
+     */
+    int _fitting (int amount) const
+    {
+        int newCapacity = 1;
+        while (amount > upFactor * newCapacity)
+        {
+            newCapacity *= CAPACITY_CHANGE;
+        }
+        return newCapacity;
+    }
+
+    /**
+     * Halves the map while it is under the lower load factor, never under one bucket
+     */
+    void _shrink ()
+    {
+        int newCapacity = _capacity;
+        while (newCapacity > 1 && (double) _size / newCapacity < loadFactor)
+        {
+            newCapacity /= CAPACITY_CHANGE;
+        }
+        if (newCapacity != _capacity)
+        {
+            _resize (newCapacity);
+        }
+    }
+
+    /**
+     * Resizes the map, at once or by starting an incremental migration. A migration that is
+     * still running is finished first.
+     * @param newCapacity New capacity
+     */
+    void _resize (int newCapacity)
+    {
+        if (! incremental)
+        {
+            _rehash (newCapacity);
+            return;
+        }
+        _migrate (oldCapacity);
+        oldMap = map;
+        oldCapacity = _capacity;
+        migrated = 0;
+        map = _allocate (newCapacity);
+        _capacity = newCapacity;
+    }
+
+    /**
+     * Moves the pairs of the next old buckets into the new bucket array, and frees the old
+     * array once every bucket is migrated
+     * @param steps Maximal amount of old buckets to migrate
+     */
+    void _migrate (int steps)
+    {
+        if (oldMap == nullptr)
+        {
+            return;
+        }
+        for ( ; steps > 0 && migrated < oldCapacity ; -- steps , ++ migrated)
+        {
+            for (auto j = oldMap[migrated].begin () ; j != oldMap[migrated].end () ; ++ j)
+            {
+                int bucket = _bucketOf (j->hashOf (hasher));
+                map[bucket].push_back (std::move (*j));
+                _mark (map , _capacity , bucket);
+            }
+            Bucket (EntryAllocator (allocator)).swap (oldMap[migrated]);
+            _unmark (oldMap , oldCapacity , migrated);
+        }
+        if (migrated == oldCapacity)
+        {
+            _free (oldMap , oldCapacity);
+            oldMap = nullptr;
+        }
+    }
 
     /**
      * Rehashes the map if needed
@@ -623,20 +1920,20 @@ private:
      */
     void _rehash (int newCapacity)
     {
-        int oldCapacity = _capacity;
+        _migrate (oldCapacity);
+        int previous = _capacity;
         _capacity = newCapacity;
-        auto *newMap = new std::vector<std::pair<KeyT , ValueT>>[newCapacity];
-        for (int i = 0 ; i < oldCapacity ; ++ i)
+        Bucket *newMap = _allocate (newCapacity);
+        for (int i = 0 ; i < previous ; ++ i)
         {
             for (auto j = map[i].begin () ; j != map[i].end () ; ++ j)
             {
-                std::pair<KeyT , ValueT> temp = *j;
-                int firstIndex = std::hash<KeyT> {} (temp.first);
-                int finalIndex = firstIndex & (newCapacity - 1);
-                newMap[finalIndex].push_back (std::make_pair (temp.first , temp.second));
+                int finalIndex = _bucketOf (j->hashOf (hasher));
+                newMap[finalIndex].push_back (std::move (*j));
+                _mark (newMap , newCapacity , finalIndex);
             }
         }
-        delete[]map;
+        _free (map , previous);
         map = newMap;
     }
 };
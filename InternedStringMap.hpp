@@ -0,0 +1,686 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_INTERNEDSTRINGMAP_HPP
+#define CPPEX3_INTERNEDSTRINGMAP_HPP
+//---------------DEFINES--------------
+#define EMPTY_INDEX 0
+
+#define MAX_KEY_BYTES 0xffffffffULL
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "HashMap.hpp"
+
+template<typename ValueT , typename Hash = StringHash>
+/**
+ * String keyed hash map that interns its keys: the bytes of every key are appended to one
+ * contiguous arena and an entry only holds the offset and length of its key, its cached hash
+ * and its value. Short keys cost no allocation of their own and no std::string header, and the
+ * entries sit back to back in insertion order, so iterating them is a linear scan.
+ * The table itself is open addressing with linear probing over indices into the entries, a
+ * probe compares the cached hash first and only then the key bytes.
+ * Keys are looked up and inserted as std::string_view, so a std::string, a const char * or a
+ * view into a mapped file can be used without building a string.
+ * Erasing moves the last entry into the hole, the bytes of erased keys stay in the arena until
+ * they outnumber the live ones and the arena is compacted.
+ * @tparam ValueT type of Value
+ * @tparam Hash type of the hash of the keys, called with a std::string_view
+ */
+class InternedStringMap
+{
+    /**
+     * One key and value pair, the key lives in the arena
+     */
+    struct Entry
+    {
+        uint32_t offset;
+        uint32_t length;
+        size_t hash;
+        ValueT value;
+    };
+
+public:
+    class const_iterator;
+
+    /**
+     * Def const
+     */
+    InternedStringMap () : deadBytes (0) , upFactor (UPPER_BOUND) , slots (INITIAL_CAPACITY ,
+                                                                          EMPTY_INDEX)
+    {
+    }
+
+    /**
+     * Constcutor for a range of pairs, a later pair overrides an earlier one with the same key
+     * @tparam InputIt type of the iterators
+     * @param first Start of the range
+     * @param last End of the range
+     */
+    template<typename InputIt>
+    InternedStringMap (InputIt first , InputIt last) : InternedStringMap ()
+    {
+        bulk_insert (first , last);
+    }
+
+    /**
+     * Inserts or assigns a range of pairs, the map is resized once up front when the length of
+     * the range is known
+     * @tparam InputIt type of the iterators
+     * @param first Start of the range
+     * @param last End of the range
+     */
+    template<typename InputIt>
+    void bulk_insert (InputIt first , InputIt last)
+    {
+        typedef typename std::iterator_traits<InputIt>::iterator_category category;
+        if constexpr (std::is_base_of<std::forward_iterator_tag , category>::value)
+        {
+            reserve (size () + (int) std::distance (first , last));
+        }
+        for ( ; first != last ; ++ first)
+        {
+            auto && entry = *first;
+            insert_or_assign (entry.first , std::forward<decltype (entry)> (entry).second);
+        }
+    }
+
+    /**
+     * Inserts the given key with value, or assigns the value if the key is already there
+     * @param key Key to insert
+     * @param value Value to insert
+     * @return true if inserted false otherwise
+     */
+    template<typename V = ValueT>
+    bool insert (std::string_view key , V && value)
+    {
+        return insert_or_assign (key , std::forward<V> (value)).second;
+    }
+
+    /**
+     * Constructs the value from the arguments if the key is missing, does nothing otherwise
+     * @param key Key to look for
+     * @param args Arguments of the value
+     * @return Iterator to the pair of the key, and true if inserted false if already there
+     */
+    template<typename... Args>
+    std::pair<const_iterator , bool> try_emplace (std::string_view key , Args && ... args)
+    {
+        size_t hash = hasher (key);
+        size_t slot = _locate (key , hash);
+        if (slots[slot] != EMPTY_INDEX)
+        {
+            return std::make_pair (_iteratorAt (slots[slot] - 1) , false);
+        }
+        if (_grow ())
+        {
+            slot = _locate (key , hash);
+        }
+        _append (slot , key , hash , std::forward<Args> (args)...);
+        return std::make_pair (_iteratorAt ((uint32_t) entries.size () - 1) , true);
+    }
+
+    /**
+     * Assigns the value to the key, inserting the key if it is missing
+     * @param key Key to set
+     * @param value Value to set
+     * @return Iterator to the pair of the key, and true if inserted false if assigned
+     */
+    template<typename V>
+    std::pair<const_iterator , bool> insert_or_assign (std::string_view key , V && value)
+    {
+        size_t hash = hasher (key);
+        size_t slot = _locate (key , hash);
+        if (slots[slot] != EMPTY_INDEX)
+        {
+            entries[slots[slot] - 1].value = std::forward<V> (value);
+            return std::make_pair (_iteratorAt (slots[slot] - 1) , false);
+        }
+        if (_grow ())
+        {
+            slot = _locate (key , hash);
+        }
+        _append (slot , key , hash , std::forward<V> (value));
+        return std::make_pair (_iteratorAt ((uint32_t) entries.size () - 1) , true);
+    }
+
+    /**
+     * Finds the pair of the key
+     * @param key Key to look for
+     * @return Iterator to the pair, end () if missing
+     */
+    const_iterator find (std::string_view key) const
+    {
+        size_t slot = _locate (key , hasher (key));
+        if (slots[slot] == EMPTY_INDEX)
+        {
+            return end ();
+        }
+        return _iteratorAt (slots[slot] - 1);
+    }
+
+    /**
+     * Checks if the key given is already in the map
+     * @param key Key to check
+     * @return true if contains false otherwise
+     */
+    bool containsKey (std::string_view key) const
+    {
+        return slots[_locate (key , hasher (key))] != EMPTY_INDEX;
+    }
+
+    /**
+     * return the ValueT of the given key,if doesnt exist throw exception
+     * @param key Key to check
+     * @return ValueT if key exists indexException otherwise
+     */
+    ValueT & at (std::string_view key)
+    {
+        uint32_t index = slots[_locate (key , hasher (key))];
+        if (index == EMPTY_INDEX)
+        {
+            throw indexException {};
+        }
+        return entries[index - 1].value;
+    }
+
+    /**
+     * return the ValueT of the given key,if doesnt exist throw exception
+     * @param key Key to check
+     * @return ValueT if key exists indexException otherwise
+     */
+    const ValueT & at (std::string_view key) const
+    {
+        uint32_t index = slots[_locate (key , hasher (key))];
+        if (index == EMPTY_INDEX)
+        {
+            throw indexException {};
+        }
+        return entries[index - 1].value;
+    }
+
+    /**
+     * Value of the key, a default value is inserted if the key is missing
+     * @param key Key to look for
+     * @return Value of the key
+     */
+    ValueT & operator[] (std::string_view key)
+    {
+        return entries[try_emplace (key).first._index].value;
+    }
+
+    /**
+     * Value of the key
+     * @param key Key to look for
+     * @return Copy of the value, a default value if the key is missing
+     */
+    ValueT operator[] (std::string_view key) const
+    {
+        uint32_t index = slots[_locate (key , hasher (key))];
+        return index == EMPTY_INDEX ? ValueT {} : entries[index - 1].value;
+    }
+
+    /**
+     * Erases the key given
+     * @param key Key to earse
+     * @return true if erased false otherwise
+     */
+    bool erase (std::string_view key)
+    {
+        size_t slot = _locate (key , hasher (key));
+        if (slots[slot] == EMPTY_INDEX)
+        {
+            return false;
+        }
+        uint32_t index = slots[slot] - 1;
+        _unlink (slot);
+        deadBytes += entries[index].length;
+        uint32_t last = (uint32_t) entries.size () - 1;
+        if (index != last)
+        {
+            slots[_slotOf (last)] = index + 1;
+            entries[index] = std::move (entries[last]);
+        }
+        entries.pop_back ();
+        if (deadBytes > arena.size () - deadBytes)
+        {
+            _compact ();
+        }
+        return true;
+    }
+
+    /**
+     * Prepares the map for the given amount of keys
+     * @param amount Amount of keys
+     */
+    void reserve (int amount)
+    {
+        entries.reserve ((size_t) amount);
+        size_t capacity = slots.size ();
+        while (amount > upFactor * capacity)
+        {
+            capacity *= CAPACITY_CHANGE;
+        }
+        if (capacity != slots.size ())
+        {
+            _rehash (capacity);
+        }
+    }
+
+    /**
+     * Clears the map of items
+     */
+    void clear ()
+    {
+        entries.clear ();
+        arena.clear ();
+        deadBytes = 0;
+        std::fill (slots.begin () , slots.end () , EMPTY_INDEX);
+    }
+
+    /**
+     * return the number of elements in the map
+     * @return number of elements in the map
+     */
+    int size () const
+    {
+        return (int) entries.size ();
+    }
+
+    /**
+     * check if the map is empty
+     * @return true if empty false otherwise
+     */
+    bool empty () const
+    {
+        return entries.empty ();
+    }
+
+    /**
+     * Returns the current capacity of the map
+     * @return Amount of slots
+     */
+    int capacity () const
+    {
+        return (int) slots.size ();
+    }
+
+    /**
+     * Current load factor of the map
+     * @return Load factor
+     */
+    double getLoadFactor () const
+    {
+        return (double) entries.size () / slots.size ();
+    }
+
+    /**
+     * Size of the key arena
+     * @return Amount of key bytes, including the ones of erased keys not compacted yet
+     */
+    size_t keyBytes () const
+    {
+        return arena.size ();
+    }
+
+    /**
+     * Check if maps equal
+     * @param other other map to check
+     * @return true if equal false otherwise
+     */
+    bool operator== (const InternedStringMap & other) const
+    {
+        if (size () != other.size ())
+        {
+            return false;
+        }
+        for (const auto & entry : entries)
+        {
+            const_iterator found = other.find (_keyOf (entry));
+            if (found == other.end () || ! (found->second == entry.value))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Check if maps are not equal
+     * @param other other map to check
+     * @return true if not equal false otherwise
+     */
+    bool operator!= (const InternedStringMap & other) const
+    {
+        return ! (*this == other);
+    }
+
+    /**
+     * const iterator over the pairs in insertion order, a pair is a view of the key and a
+     * reference to the value
+     */
+    class const_iterator
+    {
+    public:
+        typedef int difference_type;
+        typedef std::pair<std::string_view , const ValueT &> value_type;
+        typedef value_type reference;
+        typedef std::forward_iterator_tag iterator_category;
+
+        /**
+         * Pair returned by operator->, keeps the pair alive while it is used
+         */
+        struct pointer
+        {
+            value_type pair;
+
+            /**
+             * Pointer to the pair
+             * @return Pointer to the pair
+             */
+            const value_type *operator-> () const
+            {
+                return &pair;
+            }
+        };
+
+        /**
+         * Constcutor for iterator
+         * @param map Map to iterate
+         * @param index Index of the entry
+         */
+        explicit const_iterator (const InternedStringMap *map = nullptr , uint32_t index = 0) :
+                _map (map) , _index (index)
+        {
+        }
+
+        /**
+         * return the current pair
+         * @return current pair
+         */
+        reference operator* () const
+        {
+            const Entry & entry = _map->entries[_index];
+            return value_type (_map->_keyOf (entry) , entry.value);
+        }
+
+        /**
+         * Pointer to the current pair
+         * @return Pointer to the current pair
+         */
+        pointer operator-> () const
+        {
+            return pointer {**this};
+        }
+
+        /**
+         * Advances the iterator foward
+         * @return Iterator after the advance
+         */
+        const_iterator & operator++ ()
+        {
+            ++ _index;
+            return *this;
+        }
+
+        /**
+         * Advances the iterator foward
+         * @return Iterator after the advance
+         */
+        const_iterator operator++ (int)
+        {
+            const_iterator tmp (*this);
+            ++ _index;
+            return tmp;
+        }
+
+        /**
+         * Compare two iterators
+         * @param other iterator to compare
+         * @return true if equal false otherwise
+         */
+        bool operator== (const const_iterator & other) const
+        {
+            return _map == other._map && _index == other._index;
+        }
+
+        /**
+         * Compare two iterators
+         * @param other iterator to compare
+         * @return true if not equal false otherwise
+         */
+        bool operator!= (const const_iterator & other) const
+        {
+            return ! (*this == other);
+        }
+
+    private:
+        friend class InternedStringMap;
+
+        const InternedStringMap *_map;
+        uint32_t _index;
+    };
+
+    /**
+     * Starting position of the iterator
+     * @return Starting position of the iterator
+     */
+    const_iterator begin () const
+    {
+        return const_iterator (this , 0);
+    }
+
+    /**
+     * End position of the iterator
+     * @return End position of the iterator
+     */
+    const_iterator end () const
+    {
+        return const_iterator (this , (uint32_t) entries.size ());
+    }
+
+    /**
+     * Starting position of the iterator
+     * @return Starting position of the iterator
+     */
+    const_iterator cbegin () const
+    {
+        return begin ();
+    }
+
+    /**
+     * End position of the iterator
+     * @return End position of the iterator
+     */
+    const_iterator cend () const
+    {
+        return end ();
+    }
+
+private:
+    /**
+     * the entries, in insertion order apart from erase moving the last one
+     */
+    std::vector<Entry> entries;
+    /**
+     * bytes of all the keys, back to back
+     */
+    std::string arena;
+    /**
+     * bytes in the arena that belong to erased keys
+     */
+    size_t deadBytes;
+    /**
+     * load factor over which the table grows
+     */
+    double upFactor;
+    /**
+     * the table, index + 1 of an entry or EMPTY_INDEX, the size is a power of two
+     */
+    std::vector<uint32_t> slots;
+    /**
+     * hash of the keys
+     */
+    Hash hasher;
+
+    /**
+     * Key of an entry
+     * @param entry Entry of the key
+     * @return View of the key in the arena
+     */
+    std::string_view _keyOf (const Entry & entry) const
+    {
+        return std::string_view (arena.data () + entry.offset , entry.length);
+    }
+
+    /**
+     * Iterator to an entry
+     * @param index Index of the entry
+     * @return Iterator to the entry
+     */
+    const_iterator _iteratorAt (uint32_t index) const
+    {
+        return const_iterator (this , index);
+    }
+
+    /**
+     * Probes for the key
+     * @param key Key to look for
+     * @param hash Hash of the key
+     * @return Slot holding the key, or the empty slot that ends its probe sequence
+     */
+    size_t _locate (std::string_view key , size_t hash) const
+    {
+        size_t mask = slots.size () - 1;
+        for (size_t slot = hash & mask ; ; slot = (slot + 1) & mask)
+        {
+            uint32_t index = slots[slot];
+            if (index == EMPTY_INDEX)
+            {
+                return slot;
+            }
+            const Entry & entry = entries[index - 1];
+            if (entry.hash == hash && entry.length == key.size () &&
+                std::memcmp (arena.data () + entry.offset , key.data () , key.size ()) == 0)
+            {
+                return slot;
+            }
+        }
+    }
+
+    /**
+     * Slot that points at the given entry
+     * @param index Index of the entry
+     * @return The slot
+     */
+    size_t _slotOf (uint32_t index) const
+    {
+        size_t mask = slots.size () - 1;
+        size_t slot = entries[index].hash & mask;
+        while (slots[slot] != index + 1)
+        {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    /**
+     * Appends a new entry and points the given empty slot at it
+     * @param slot Empty slot of the key
+     * @param key Key of the entry
+     * @param hash Hash of the key
+     * @param args Arguments of the value
+     */
+    template<typename... Args>
+    void _append (size_t slot , std::string_view key , size_t hash , Args && ... args)
+    {
+        if (arena.size () + key.size () > MAX_KEY_BYTES)
+        {
+            throw sizeException ();
+        }
+        entries.push_back (Entry {(uint32_t) arena.size () , (uint32_t) key.size () , hash ,
+                                  ValueT (std::forward<Args> (args)...)});
+        arena.append (key.data () , key.size ());
+        slots[slot] = (uint32_t) entries.size ();
+    }
+
+    /**
+     * Empties a slot and shifts the rest of its probe run back, so no tombstone is needed
+     * @param slot Slot to empty
+     */
+    void _unlink (size_t slot)
+    {
+        size_t mask = slots.size () - 1;
+        size_t hole = slot;
+        for (size_t next = (hole + 1) & mask ; slots[next] != EMPTY_INDEX ; next = (next + 1) & mask)
+        {
+            size_t home = entries[slots[next] - 1].hash & mask;
+            // the entry may fill the hole if its home is not cyclically inside (hole , next]
+            if (((next - home) & mask) >= ((next - hole) & mask))
+            {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+        }
+        slots[hole] = EMPTY_INDEX;
+    }
+
+    /**
+     * Doubles the table if one more entry would pass the upper load factor
+     * @return true if the table was resized false otherwise
+     */
+    bool _grow ()
+    {
+        if (entries.size () + 1 <= upFactor * slots.size ())
+        {
+            return false;
+        }
+        _rehash (slots.size () * CAPACITY_CHANGE);
+        return true;
+    }
+
+    /**
+     * Rebuilds the table with the given amount of slots from the cached hashes
+     * @param capacity New amount of slots, a power of two
+     */
+    void _rehash (size_t capacity)
+    {
+        slots.assign (capacity , EMPTY_INDEX);
+        size_t mask = capacity - 1;
+        for (uint32_t i = 0 ; i < entries.size () ; ++ i)
+        {
+            size_t slot = entries[i].hash & mask;
+            while (slots[slot] != EMPTY_INDEX)
+            {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = i + 1;
+        }
+    }
+
+    /**
+     * Copies the live keys into a new arena, dropping the bytes of erased keys
+     */
+    void _compact ()
+    {
+        std::string live;
+        live.reserve (arena.size () - deadBytes);
+        for (auto & entry : entries)
+        {
+            uint32_t offset = (uint32_t) live.size ();
+            live.append (arena.data () + entry.offset , entry.length);
+            entry.offset = offset;
+        }
+        arena.swap (live);
+        deadBytes = 0;
+    }
+};
+
+#endif //CPPEX3_INTERNEDSTRINGMAP_HPP
@@ -0,0 +1,215 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_MAPPEDFILE_HPP
+#define CPPEX3_MAPPEDFILE_HPP
+//---------------DEFINES--------------
+#define READ_CHUNK 65536
+
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Read only view of a whole file.
+ * Regular files are memory mapped, anything that can not be mapped (pipes, special files) is
+ * read into one buffer, presized when the size is known.
+ */
+class MappedFile
+{
+public:
+    /**
+     * Def const, an empty view
+     */
+    MappedFile () : _data (nullptr) , _size (0) , mapped (false)
+    {
+    }
+
+    MappedFile (const MappedFile & other) = delete;
+
+    MappedFile & operator= (const MappedFile & other) = delete;
+
+    /**
+     * Destructor
+     */
+    ~MappedFile ()
+    {
+        close ();
+    }
+
+    /**
+     * Opens the file and maps or reads it
+     * @param path Path of the file
+     * @return true if invalid false otherwise
+     */
+    bool open (const std::string & path)
+    {
+        close ();
+        int fd = ::open (path.c_str () , O_RDONLY);
+        if (fd == - 1)
+        {
+            return true;
+        }
+        struct stat info {};
+        if (fstat (fd , &info) == - 1 || S_ISDIR (info.st_mode))
+        {
+            ::close (fd);
+            return true;
+        }
+        if (S_ISREG (info.st_mode) && info.st_size > 0)
+        {
+            void *view = mmap (nullptr , (size_t) info.st_size , PROT_READ , MAP_PRIVATE , fd , 0);
+            if (view != MAP_FAILED)
+            {
+                madvise (view , (size_t) info.st_size , MADV_SEQUENTIAL);
+                ::close (fd);
+                _data = (const char *) view;
+                _size = (size_t) info.st_size;
+                mapped = true;
+                return false;
+            }
+        }
+        bool invalid = _readAll (fd , S_ISREG (info.st_mode) ? (size_t) info.st_size : 0);
+        ::close (fd);
+        return invalid;
+    }
+
+    /**
+     * Reads the file in fixed size chunks through one buffer, memory use does not depend on
+     * the size of the file
+     * @tparam F type of the callback
+     * @param path Path of the file
+     * @param chunkSize Size of the buffer
+     * @param callback Called with every chunk as (data , size), returns false to stop reading
+     * @return true if invalid false otherwise
+     */
+    template<typename F>
+    static bool stream (const std::string & path , size_t chunkSize , F callback)
+    {
+        int fd = ::open (path.c_str () , O_RDONLY);
+        if (fd == - 1)
+        {
+            return true;
+        }
+        struct stat info {};
+        if (fstat (fd , &info) == - 1 || S_ISDIR (info.st_mode))
+        {
+            ::close (fd);
+            return true;
+        }
+        posix_fadvise (fd , 0 , 0 , POSIX_FADV_SEQUENTIAL);
+        std::vector<char> chunk (chunkSize);
+        while (true)
+        {
+            ssize_t got = read (fd , chunk.data () , chunk.size ());
+            if (got == - 1 && errno == EINTR)
+            {
+                continue;
+            }
+            if (got <= 0)
+            {
+                ::close (fd);
+                return got == - 1;
+            }
+            if (! callback ((const char *) chunk.data () , (size_t) got))
+            {
+                ::close (fd);
+                return false;
+            }
+        }
+    }
+
+    /**
+     * Unmaps the file and frees the buffer
+     */
+    void close ()
+    {
+        if (mapped)
+        {
+            munmap ((void *) _data , _size);
+        }
+        std::vector<char> ().swap (buffer);
+        _data = nullptr;
+        _size = 0;
+        mapped = false;
+    }
+
+    /**
+     * Start of the file content
+     * @return Start of the file content
+     */
+    const char *data () const
+    {
+        return _data;
+    }
+
+    /**
+     * Size of the file content
+     * @return Size of the file content
+     */
+    size_t size () const
+    {
+        return _size;
+    }
+
+private:
+    /**
+     * start of the content, inside the mapping or the buffer
+     */
+    const char *_data;
+    /**
+     * size of the content
+     */
+    size_t _size;
+    /**
+     * true if the content is mapped
+     */
+    bool mapped;
+    /**
+     * content of files that could not be mapped
+     */
+    std::vector<char> buffer;
+
+    /**
+     * Reads the whole file into the buffer
+     * @param fd File to read
+     * @param expected Expected size, 0 if unknown
+     * @return true if invalid false otherwise
+     */
+    bool _readAll (int fd , size_t expected)
+    {
+        buffer.resize (expected > 0 ? expected : READ_CHUNK);
+        size_t used = 0;
+        while (true)
+        {
+            if (used == buffer.size ())
+            {
+                buffer.resize (buffer.size () * 2);
+            }
+            ssize_t got = read (fd , buffer.data () + used , buffer.size () - used);
+            if (got == - 1 && errno == EINTR)
+            {
+                continue;
+            }
+            if (got == - 1)
+            {
+                return true;
+            }
+            if (got == 0)
+            {
+                break;
+            }
+            used += (size_t) got;
+        }
+        _data = buffer.data ();
+        _size = used;
+        return false;
+    }
+};
+
+#endif //CPPEX3_MAPPEDFILE_HPP
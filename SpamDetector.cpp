@@ -2,24 +2,219 @@
 // Created by mikemerzl on 20/01/2020.
 //
 #include <boost/filesystem.hpp>
-#include <boost/tokenizer.hpp>
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <optional>
+#include <thread>
 #include "HashMap.hpp"
+#include "AhoCorasick.hpp"
+#include "BoundedQueue.hpp"
+#include "ByteKernels.hpp"
+#include "CompiledDatabase.hpp"
+#include "DatabaseParser.hpp"
+#include "MappedFile.hpp"
+#include "TokenMatcher.hpp"
+#ifdef SPAM_EMBEDDED_DB
+// path of a header written by --emit-cpp, e.g. -DSPAM_EMBEDDED_DB='"SpamDatabase.hpp"'
+#include SPAM_EMBEDDED_DB
+#endif
 //--------------DEFINES-----------------
 #define INVALID_INPUT "Invalid input"
 #define USAGE_ERROR "Usage: SpamDetector <database path> <message path> <threshold>"
 #define SPAM "SPAM"
 #define NOT_SPAM "NOT_SPAM"
 #define EXPECTED_ARG_AMOUNT 4
-typedef boost::tokenizer<boost::char_separator<char>> Tok;
+#define BATCH_USAGE_ERROR "Usage: SpamDetector --batch [-0] [--threads <amount>] <database path> <directory|list path|-> <threshold>"
+#define COMPILE_USAGE_ERROR "Usage: SpamDetector --compile <database path> <output path>"
+#define BATCH_FLAG "--batch"
+#define COMPILE_FLAG "--compile"
+#define EMIT_USAGE_ERROR "Usage: SpamDetector --emit-cpp <database path> <output path>"
+#define EMIT_FLAG "--emit-cpp"
+#define EMBEDDED_PATH "@embedded"
+#define NUL_FLAG "-0"
+#define STDIN_PATH "-"
+#define VERDICT_SEPARATOR '\t'
+#define THREADS_FLAG "--threads"
+#define THREADS_PER_CORE 4
+#define QUEUE_PER_THREAD 64
+#define WINDOW_PER_THREAD 256
+#define MAP_LIMIT (64 << 20)
+#define STREAM_CHUNK (64 << 10)
+#define STATS_FLAG "--stats"
+#define MODE_FLAG "--mode"
+#define SUBSTRING_MODE "substring"
+#define TOKEN_MODE "token"
+#define BLOOM_FLAG "--bloom-fpr"
+
+/**
+ * Counters of the verdict only scoring, shared by all the workers.
+ */
+struct ScanStats
+{
+    /**
+     * bytes scanned
+     */
+    std::atomic<unsigned long long> scanned {0};
+    /**
+     * bytes left unscanned because the threshold was already reached, only known for
+     * regular files
+     */
+    std::atomic<unsigned long long> skipped {0};
+    /**
+     * messages whose scan stopped early
+     */
+    std::atomic<unsigned long long> stopped {0};
+    /**
+     * token windows found in the table
+     */
+    std::atomic<unsigned long long> windowHits {0};
+    /**
+     * token windows not in the table
+     */
+    std::atomic<unsigned long long> windowMisses {0};
+    /**
+     * token windows not in the table that the filter let through
+     */
+    std::atomic<unsigned long long> falsePositives {0};
+};
+
+/**
+ * The database opened for scoring: an automaton for substring matches, or a table of token
+ * windows for whole token matches, only the one of the chosen mode is built. Neither allocates
+ * until it is built, so the embedded database is used with no heap allocation.
+ */
+struct Detector
+{
+    /**
+     * true to score whole token matches, false to score substring matches
+     */
+    bool tokenMode = false;
+    /**
+     * false positive rate of the filter of the token windows, 0 for no filter
+     */
+    double falsePositiveRate = 0;
+    /**
+     * automaton of the substring mode
+     */
+    AhoCorasick matcher;
+    /**
+     * matcher of the token mode, only built in token mode
+     */
+    std::optional<TokenMatcher> tokens;
+};
+
+/**
+ * Prints the verdicts of a batch in input order while the messages are classified in any order.
+ */
+class OrderedOutput
+{
+public:
+    /**
+     * Constructor
+     * @param window Maximal amount of messages in flight ahead of the next one to print
+     */
+    explicit OrderedOutput (size_t window) : _window (window) , next (0) , _failed (false)
+    {
+    }
+
+    /**
+     * Blocks until the message is close enough to the next one to print, so a slow message
+     * can not make the pending verdicts grow without bound.
+     * @param sequence Position of the message in the input
+     */
+    void reserve (size_t sequence)
+    {
+        std::unique_lock<std::mutex> lock (mutex);
+        printed.wait (lock , [this , sequence] ()
+        { return sequence < next + _window; });
+    }
+
+    /**
+     * Records the verdict of a message and prints every verdict that is now in order
+     * @param sequence Position of the message in the input
+     * @param invalid true if the message could not be read
+     * @param spam true if the message is spam
+     * @param message Path of the message
+     */
+    void put (size_t sequence , bool invalid , bool spam , std::string message)
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        pending[sequence] = std::make_pair (invalid ? - 1 : (int) spam , std::move (message));
+        auto i = pending.begin ();
+        while (i != pending.end () && i->first == next)
+        {
+            if (i->second.first == - 1)
+            {
+                std::cerr << INVALID_INPUT << ": " << i->second.second << std::endl;
+                _failed = true;
+            }
+            else
+            {
+                std::cout << (i->second.first ? SPAM : NOT_SPAM) << VERDICT_SEPARATOR
+                          << i->second.second << '\n';
+            }
+            i = pending.erase (i);
+            ++ next;
+        }
+        printed.notify_all ();
+    }
+
+    /**
+     * Checks if any message could not be read
+     * @return true if a message failed false otherwise
+     */
+    bool failed () const
+    {
+        return _failed;
+    }
+
+private:
+    /**
+     * maximal amount of messages in flight
+     */
+    size_t _window;
+    /**
+     * position of the next message to print
+     */
+    size_t next;
+    /**
+     * true once a message could not be read
+     */
+    bool _failed;
+    /**
+     * verdicts waiting for earlier messages, -1 for invalid, 1 for spam and 0 otherwise
+     */
+    std::map<size_t , std::pair<int , std::string>> pending;
+    /**
+     * guards all the members
+     */
+    std::mutex mutex;
+    /**
+     * signaled when verdicts are printed
+     */
+    std::condition_variable printed;
+};
 //----------------functions-------------------
 /**
- * Find all the appreances of the current text.
- * @param map HashMap of all the database.
- * @param allText The string of all the file we check.
- * @return Final sum of the "points" of the file.
+ * Find all the appreances of the current text, case folding is done by the scanner while it
+ * scans the file content in place. The scan stops once the threshold is reached.
+ * @param scanner Scanner of the automaton compiled from the database.
+ * @param message The file we check.
+ * @return Amount of bytes scanned.
  */
-static int findAll (const HashMap<std::string , int> & map , const std::string & allText);
+static size_t findAll (AhoCorasick::Scanner & scanner , const MappedFile & message);
+
+/**
+ * Find all the whole token appreances of the current text. The scan stops once the threshold
+ * is reached.
+ * @param scanner Scanner of the token windows of the database.
+ * @param message The file we check.
+ * @return Amount of bytes scanned.
+ */
+static size_t findAll (TokenMatcher::Scanner & scanner , const MappedFile & message);
 
 /**
  * Check validity for second argument.
@@ -29,17 +224,18 @@ static int findAll (const HashMap<std::string , int> & map , const std::string &
 static bool checkValid (const std::string & check);
 
 /**
- * Lowers to line given to smallcase letters.
- * @param text String to lower.
+ * Checks the amount of worker threads, at least 1 and at most THREADS_PER_CORE per core.
+ * @param check Amount given
+ * @param threads Set to the amount when valid
+ * @return true if invalid false otherwise
  */
-static void lowerAll (std::string & text);
+static bool checkThreads (const std::string & check , unsigned int & threads);
 
 /**
- * Check validity of the given line
- * @param tok Tokenizer
- * @return true if line is invalid false otherwise
+ * Lowers to line given to smallcase letters.
+ * @param text String to lower.
  */
-bool checkValidLine (const Tok & tok);
+static void lowerAll (std::string & text);
 
 /**
  * Prints the final output
@@ -49,20 +245,116 @@ bool checkValidLine (const Tok & tok);
 void finalOutput (int finalScore , int minimumScore);
 
 /**
- * Check validity of the database file given.
- * @param line Current line to check
- * @param tok Tokenizer
+ * Checks for the validity and amount of arguments given.
+ * @param argc Number of arguments given
+ * @param argv Arguments given
+ * @return true if invalid false otherwise
+ */
+bool checkArgs (int argc , char *const *argv);
+
+/**
+ * Parses the database into the table. The file is mapped, or read at once, and parsed in place
+ * by DatabaseParser, split over the hardware threads when it is large.
+ * @param path Path of the database file
+ * @param table Table to fill
  * @return true if invalid false otherwise
  */
-bool dbValidCheck (const std::string & line , const Tok & tok);
+bool loadDatabase (const std::string & path , PatternTable & table);
 
 /**
- * Checks for the validity and amount of arguments given.
+ * Opens the database, a compiled database is mapped and its matcher used as is, anything else
+ * is parsed as CSV and compiled in memory. In token mode the phrases are read back from either
+ * and their token windows built, the embedded database has no phrases and is invalid there.
+ * @param p Path of the database
+ * @param compiled Keeps a compiled database mapped while its matcher is in use
+ * @param detector Its matcher of the chosen mode is set from the database
+ * @return true if invalid false otherwise
+ */
+bool openDatabase (const boost::filesystem::path & p , CompiledDatabase & compiled ,
+                   Detector & detector);
+
+/**
+ * Checks if the database path names the database built into the binary.
+ * @param p Path of the database
+ * @return true if embedded false otherwise, always false unless built with SPAM_EMBEDDED_DB
+ */
+static bool isEmbedded (const boost::filesystem::path & p);
+
+/**
+ * Compiles a CSV database into the binary format read by openDatabase, or with --emit-cpp into
+ * a C++ header that SPAM_EMBEDDED_DB builds into the binary.
  * @param argc Number of arguments given
  * @param argv Arguments given
+ * @return Exit code
+ */
+int compileMain (int argc , char *argv[]);
+
+/**
+ * Calls the callback for every message path of the batch source.
+ * @param source Directory, list file or STDIN_PATH for standard input
+ * @param delimiter Delimiter between the paths of a list file or standard input
+ * @param callback Called with every path
  * @return true if invalid false otherwise
  */
-bool checkArgs (int argc , char *const *argv);
+bool forEachPath (const std::string & source , char delimiter ,
+                  const std::function<void (const std::string &)> & callback);
+
+/**
+ * Scores a message with the matcher of the mode of the detector.
+ * @param detector Database opened for scoring
+ * @param message Path of the message
+ * @param minimumScore Threshhold, scanning stops once it is reached
+ * @param finalScore Set to the score of the message, capped near the threshold
+ * @param stats Counters to update
+ * @return true if the message could not be read false otherwise
+ */
+bool scoreMessage (const Detector & detector , const std::string & message , int minimumScore ,
+                   int & finalScore , ScanStats & stats);
+
+/**
+ * Scores a message until the score reaches the threshold. Regular files up to MAP_LIMIT bytes
+ * are mapped and scanned at once, larger files and anything that can not be mapped are read in
+ * STREAM_CHUNK sized chunks, so memory use stays constant whatever the size of the message.
+ * @tparam Scanner AhoCorasick::Scanner or TokenMatcher::Scanner
+ * @param scanner Scanner to score with, made with the threshold as its limit
+ * @param message Path of the message
+ * @param finalScore Set to the score of the message, capped near the threshold
+ * @param stats Counters to update
+ * @return true if the message could not be read false otherwise
+ */
+template<typename Scanner>
+bool scanMessage (Scanner & scanner , const std::string & message , int & finalScore ,
+                  ScanStats & stats);
+
+/**
+ * Prints the counters of the scoring to the error stream.
+ * @param stats Counters to print
+ * @param tokenMode true to also print the counters of the token windows
+ */
+void printStats (const ScanStats & stats , bool tokenMode);
+
+/**
+ * Reads and scores one message of the batch.
+ * @param detector Database opened for scoring
+ * @param minimumScore Threshhold
+ * @param message Path of the message
+ * @param spam Set to true if the message is spam
+ * @param stats Counters to update
+ * @return true if the message could not be read false otherwise
+ */
+bool classify (const Detector & detector , int minimumScore , const std::string & message ,
+               bool & spam , ScanStats & stats);
+
+/**
+ * Loads the database once and prints a verdict for every message of the batch, the messages
+ * are classified by a pool of worker threads fed through a bounded queue.
+ * @param argc Number of arguments given
+ * @param argv Arguments given
+ * @param detector Mode and filter rate of the scoring, its matcher is set from the database
+ * @param stats Counters to update
+ * @return Exit code
+ */
+int batchMain (int argc , char *argv[] , Detector & detector , ScanStats & stats);
 
 /**
  * Checks if files exists.
@@ -76,6 +368,68 @@ bool checkExistValid (int minimumScore , const boost::filesystem::path & p ,
 
 int main (int argc , char *argv[])
 {
+    ScanStats stats;
+    bool showStats = false;
+    Detector detector;
+    // the options come first, in any order, and are dropped so every mode sees its usual arguments
+    while (argc > 1)
+    {
+        std::string flag (argv[1]);
+        if (flag == STATS_FLAG)
+        {
+            showStats = true;
+            -- argc;
+            ++ argv;
+        }
+        else if (flag == MODE_FLAG && argc > 2)
+        {
+            std::string mode (argv[2]);
+            if (mode != SUBSTRING_MODE && mode != TOKEN_MODE)
+            {
+                std::cerr << INVALID_INPUT << std::endl;
+                return EXIT_FAILURE;
+            }
+            detector.tokenMode = mode == TOKEN_MODE;
+            argc -= 2;
+            argv += 2;
+        }
+        else if (flag == BLOOM_FLAG && argc > 2)
+        {
+            char *end = nullptr;
+            detector.falsePositiveRate = strtod (argv[2] , &end);
+            if (end == argv[2] || *end != '\0' || ! (detector.falsePositiveRate > 0) ||
+                detector.falsePositiveRate >= 1)
+            {
+                std::cerr << INVALID_INPUT << std::endl;
+                return EXIT_FAILURE;
+            }
+            argc -= 2;
+            argv += 2;
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (detector.falsePositiveRate > 0 && ! detector.tokenMode)
+    {
+        // only the token mode has a table to put the filter in front of
+        std::cerr << INVALID_INPUT << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (argc > 1 && std::string (argv[1]) == BATCH_FLAG)
+    {
+        int code = batchMain (argc , argv , detector , stats);
+        if (showStats)
+        {
+            printStats (stats , detector.tokenMode);
+        }
+        return code;
+    }
+    if (argc > 1 && (std::string (argv[1]) == COMPILE_FLAG || std::string (argv[1]) == EMIT_FLAG))
+    {
+        return compileMain (argc , argv);
+    }
     if (checkArgs (argc , argv))
     {
         return (EXIT_FAILURE);
@@ -83,65 +437,344 @@ int main (int argc , char *argv[])
     int minimumScore = (int) strtol (argv[3] , nullptr , 10);
     boost::filesystem::path p (argv[1]);
     boost::filesystem::path text (argv[2]);
-    boost::filesystem::ifstream in (p);
-    boost::filesystem::ifstream inT (text);
     if (checkExistValid (minimumScore , p , text))
     {
         return EXIT_FAILURE;
     }
-    boost::char_separator<char> sep {","};
-    std::string line;
-    HashMap<std::string , int> table;
-    while (getline (in , line))
+    CompiledDatabase compiled;
+    if (openDatabase (p , compiled , detector))
     {
-        Tok tok {line , sep};
-        if (dbValidCheck (line , tok))
-        {
-            std::cerr << INVALID_INPUT << std::endl;
-            in.close ();
-            inT.close ();
-            return (EXIT_FAILURE);
-        }
-        std::string name = *tok.begin ();
-        int score = std::stoi ((*(++ tok.begin ())));
-        lowerAll (name);
-        table.insert (name , score);
+        std::cerr << INVALID_INPUT << std::endl;
+        return (EXIT_FAILURE);
     }
-    std::string allText;
-    std::string temp;
-    while (getline (inT , temp))
+    int finalScore = 0;
+    if (scoreMessage (detector , text.string () , minimumScore , finalScore , stats))
     {
-        lowerAll (temp);
-        allText += temp;
-        allText += "\n";
+        std::cerr << INVALID_INPUT << std::endl;
+        return (EXIT_FAILURE);
     }
-    int finalScore = findAll (table , allText);
     finalOutput (finalScore , minimumScore);
-    in.close ();
-    inT.close ();
+    if (showStats)
+    {
+        printStats (stats , detector.tokenMode);
+    }
     return 0;
 
 }
 
-bool checkExistValid (int minimumScore , const boost::filesystem::path & p ,
-                      const boost::filesystem::path & text)
+int batchMain (int argc , char *argv[] , Detector & detector , ScanStats & stats)
 {
-    if (! boost::filesystem::exists (p) || ! boost::filesystem::exists (text) || minimumScore <= 0)
+    int first = 2;
+    char delimiter = '\n';
+    unsigned int threads = 1;
+    while (argc > first)
+    {
+        std::string flag (argv[first]);
+        if (flag == NUL_FLAG)
+        {
+            delimiter = '\0';
+            ++ first;
+        }
+        else if (flag == THREADS_FLAG && argc > first + 1)
+        {
+            if (checkThreads (argv[first + 1] , threads))
+            {
+                std::cerr << INVALID_INPUT << std::endl;
+                return EXIT_FAILURE;
+            }
+            first += 2;
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (argc != first + EXPECTED_ARG_AMOUNT - 1)
+    {
+        std::cerr << BATCH_USAGE_ERROR << std::endl;
+        return EXIT_FAILURE;
+    }
+    boost::filesystem::path p (argv[first]);
+    std::string source (argv[first + 1]);
+    if (checkValid (argv[first + 2]))
+    {
+        std::cerr << INVALID_INPUT << std::endl;
+        return EXIT_FAILURE;
+    }
+    int minimumScore = (int) strtol (argv[first + 2] , nullptr , 10);
+    if (checkExistValid (minimumScore , p , source == STDIN_PATH ? p : source))
+    {
+        return EXIT_FAILURE;
+    }
+    CompiledDatabase compiled;
+    if (openDatabase (p , compiled , detector))
+    {
+        std::cerr << INVALID_INPUT << std::endl;
+        return EXIT_FAILURE;
+    }
+    OrderedOutput output (threads * WINDOW_PER_THREAD);
+    BoundedQueue<std::pair<size_t , std::string>> jobs (threads * QUEUE_PER_THREAD);
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0 ; i < threads ; ++ i)
+    {
+        workers.emplace_back ([&] ()
+                              {
+                                  // every worker keeps its own score
+                                  std::pair<size_t , std::string> job;
+                                  while (jobs.pop (job))
+                                  {
+                                      bool spam = false;
+                                      bool invalid = classify (detector , minimumScore ,
+                                                               job.second , spam , stats);
+                                      output.put (job.first , invalid , spam , job.second);
+                                  }
+                              });
+    }
+    size_t sequence = 0;
+    bool invalid = forEachPath (source , delimiter , [&] (const std::string & message)
+    {
+        output.reserve (sequence);
+        jobs.push (std::make_pair (sequence ++ , message));
+    });
+    jobs.close ();
+    for (auto & worker : workers)
+    {
+        worker.join ();
+    }
+    std::cout.flush ();
+    if (invalid)
     {
         std::cerr << INVALID_INPUT << std::endl;
+    }
+    return (invalid || output.failed ()) ? EXIT_FAILURE : 0;
+}
+
+bool classify (const Detector & detector , int minimumScore , const std::string & message ,
+               bool & spam , ScanStats & stats)
+{
+    int finalScore = 0;
+    if (scoreMessage (detector , message , minimumScore , finalScore , stats))
+    {
         return true;
     }
+    spam = finalScore >= minimumScore;
     return false;
 }
 
-bool checkArgs (int argc , char *const *argv)
+bool scoreMessage (const Detector & detector , const std::string & message , int minimumScore ,
+                   int & finalScore , ScanStats & stats)
+{
+    if (detector.tokenMode)
+    {
+        TokenMatcher::Scanner scanner (*detector.tokens , minimumScore);
+        return scanMessage (scanner , message , finalScore , stats);
+    }
+    AhoCorasick::Scanner scanner (detector.matcher , minimumScore);
+    return scanMessage (scanner , message , finalScore , stats);
+}
+
+template<typename Scanner>
+bool scanMessage (Scanner & scanner , const std::string & message , int & finalScore ,
+                  ScanStats & stats)
+{
+    size_t scanned = 0;
+    boost::system::error_code error;
+    bool regular = boost::filesystem::is_regular_file (message , error);
+    size_t length = regular ? (size_t) boost::filesystem::file_size (message , error) : 0;
+    if (regular && ! error && length <= MAP_LIMIT)
+    {
+        MappedFile text;
+        if (text.open (message))
+        {
+            return true;
+        }
+        length = text.size ();
+        scanned = findAll (scanner , text);
+    }
+    else if (MappedFile::stream (message , STREAM_CHUNK , [&] (const char *data , size_t size)
+    {
+        scanned += scanner.feed (data , size);
+        return ! scanner.reached ();
+    }))
+    {
+        return true;
+    }
+    if constexpr (std::is_same<Scanner , TokenMatcher::Scanner>::value)
+    {
+        // a message read in chunks may end in the middle of a token
+        scanner.finish ();
+        stats.windowHits += scanner.hits ();
+        stats.windowMisses += scanner.misses ();
+        stats.falsePositives += scanner.falsePositives ();
+    }
+    finalScore = scanner.score ();
+    stats.scanned += scanned;
+    if (scanner.reached ())
+    {
+        ++ stats.stopped;
+        stats.skipped += length > scanned ? length - scanned : 0;
+    }
+    return false;
+}
+
+void printStats (const ScanStats & stats , bool tokenMode)
 {
+    std::cerr << "Scanned bytes: " << stats.scanned << std::endl;
+    std::cerr << "Skipped bytes: " << stats.skipped << std::endl;
+    std::cerr << "Early exits: " << stats.stopped << std::endl;
+    if (tokenMode)
+    {
+        std::cerr << "Window hits: " << stats.windowHits << std::endl;
+        std::cerr << "Window misses: " << stats.windowMisses << std::endl;
+        std::cerr << "Filter false positives: " << stats.falsePositives << std::endl;
+    }
+}
+
+int compileMain (int argc , char *argv[])
+{
+    bool source = std::string (argv[1]) == EMIT_FLAG;
     if (argc != EXPECTED_ARG_AMOUNT)
     {
-        std::cerr << USAGE_ERROR << std::endl;
+        std::cerr << (source ? EMIT_USAGE_ERROR : COMPILE_USAGE_ERROR) << std::endl;
+        return EXIT_FAILURE;
+    }
+    boost::filesystem::path p (argv[2]);
+    if (! boost::filesystem::exists (p))
+    {
+        std::cerr << INVALID_INPUT << std::endl;
+        return EXIT_FAILURE;
+    }
+    PatternTable table;
+    if (loadDatabase (p.string () , table))
+    {
+        std::cerr << INVALID_INPUT << std::endl;
+        return EXIT_FAILURE;
+    }
+    AhoCorasick matcher (table);
+    if (source ? CompiledDatabase::writeSource (argv[3] , table , matcher) :
+        CompiledDatabase::write (argv[3] , table , matcher))
+    {
+        std::cerr << INVALID_INPUT << std::endl;
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
+
+bool openDatabase (const boost::filesystem::path & p , CompiledDatabase & compiled ,
+                   Detector & detector)
+{
+#ifdef SPAM_EMBEDDED_DB
+    if (isEmbedded (p))
+    {
+        if (detector.tokenMode)
+        {
+            return true;
+        }
+        detector.matcher = AhoCorasick (EmbeddedDatabase::classes , EmbeddedDatabase::states ,
+                               EmbeddedDatabase::classOf , EmbeddedDatabase::delta ,
+                               EmbeddedDatabase::out);
+        return false;
+    }
+#endif
+    if (CompiledDatabase::isCompiled (p.string ()))
+    {
+        if (compiled.open (p.string ()))
+        {
+            return true;
+        }
+        if (! detector.tokenMode)
+        {
+            detector.matcher = compiled.matcher ();
+            return false;
+        }
+        PatternTable table;
+        compiled.fill (table);
+        detector.tokens.emplace (table , detector.falsePositiveRate);
+        return false;
+    }
+    PatternTable table;
+    if (loadDatabase (p.string () , table))
+    {
         return true;
     }
-    if (checkValid (argv[3]))
+    if (detector.tokenMode)
+    {
+        detector.tokens.emplace (table , detector.falsePositiveRate);
+    }
+    else
+    {
+        detector.matcher = AhoCorasick (table);
+    }
+    return false;
+}
+
+bool loadDatabase (const std::string & path , PatternTable & table)
+{
+    MappedFile file;
+    std::vector<DatabaseParser::Entry> entries;
+    if (file.open (path) || DatabaseParser::parse (file.data () , file.size () , entries ,
+                                                   std::thread::hardware_concurrency ()))
+    {
+        return true;
+    }
+    table.reserve (table.size () + (int) entries.size ());
+    std::string name;
+    for (const auto & entry : entries)
+    {
+        // the phrase is lowered in one reused buffer, the table copies it into its arena
+        name.assign (entry.first);
+        lowerAll (name);
+        table.insert (name , entry.second);
+    }
+    return false;
+}
+
+bool forEachPath (const std::string & source , char delimiter ,
+                  const std::function<void (const std::string &)> & callback)
+{
+    if (source != STDIN_PATH && boost::filesystem::is_directory (source))
+    {
+        std::vector<boost::filesystem::path> entries;
+        for (const auto & entry : boost::filesystem::directory_iterator (source))
+        {
+            if (boost::filesystem::is_regular_file (entry.status ()))
+            {
+                entries.push_back (entry.path ());
+            }
+        }
+        std::sort (entries.begin () , entries.end ());
+        for (const auto & entry : entries)
+        {
+            callback (entry.string ());
+        }
+        return false;
+    }
+    boost::filesystem::ifstream list;
+    if (source != STDIN_PATH)
+    {
+        list.open (source);
+        if (! list)
+        {
+            return true;
+        }
+    }
+    std::istream & paths = source == STDIN_PATH ? std::cin : list;
+    std::string path;
+    while (getline (paths , path , delimiter))
+    {
+        if (! path.empty ())
+        {
+            callback (path);
+        }
+    }
+    return false;
+}
+
+bool checkExistValid (int minimumScore , const boost::filesystem::path & p ,
+                      const boost::filesystem::path & text)
+{
+    if ((! isEmbedded (p) && ! boost::filesystem::exists (p)) ||
+        ! boost::filesystem::exists (text) || minimumScore <= 0)
     {
         std::cerr << INVALID_INPUT << std::endl;
         return true;
@@ -149,14 +782,19 @@ bool checkArgs (int argc , char *const *argv)
     return false;
 }
 
-bool dbValidCheck (const std::string & line , const Tok & tok)
+bool checkArgs (int argc , char *const *argv)
 {
-    if (line.find_first_of (',') != line.find_last_of (',') ||
-        line.find_first_of (',') == std::string::npos || line.size () == 1)
+    if (argc != EXPECTED_ARG_AMOUNT)
+    {
+        std::cerr << USAGE_ERROR << std::endl;
+        return true;
+    }
+    if (checkValid (argv[3]))
     {
+        std::cerr << INVALID_INPUT << std::endl;
         return true;
     }
-    return checkValidLine (tok);
+    return false;
 }
 
 void finalOutput (int finalScore , int minimumScore)
@@ -171,38 +809,40 @@ void finalOutput (int finalScore , int minimumScore)
     }
 }
 
-bool checkValidLine (const Tok & tok)
+static bool isEmbedded (const boost::filesystem::path & p)
 {
-    auto it = tok.begin ();
-    int counter = 0;
-    while (it != tok.end ())
-    {
-        if (counter == 1)
-        {
-            if (checkValid (*it))
-            {
-                return true;
-            }
-        }
-        counter ++;
-        ++ it;
-    }
-    return counter != 2;
+#ifdef SPAM_EMBEDDED_DB
+    return p.string () == EMBEDDED_PATH;
+#else
+    (void) p;
+    return false;
+#endif
+}
+
+static size_t findAll (AhoCorasick::Scanner & scanner , const MappedFile & message)
+{
+    return scanner.feed (message.data () , message.size ());
 }
 
-static int findAll (const HashMap<std::string , int> & map , const std::string & allText)
+static size_t findAll (TokenMatcher::Scanner & scanner , const MappedFile & message)
 {
-    int score = 0;
-    for (const auto & i : map)
+    return scanner.feed (message.data () , message.size ());
+}
+
+static bool checkThreads (const std::string & check , unsigned int & threads)
+{
+    if (check.empty () || checkValid (check))
     {
-        size_t next = allText.find (i.first);
-        while (next != std::string::npos)
-        {
-            score += i.second;
-            next = allText.find (i.first , next + 1);
-        }
+        return true;
+    }
+    unsigned long limit = THREADS_PER_CORE * std::max (1u , std::thread::hardware_concurrency ());
+    unsigned long amount = strtoul (check.c_str () , nullptr , 10);
+    if (amount < 1 || amount > limit)
+    {
+        return true;
     }
-    return score;
+    threads = (unsigned int) amount;
+    return false;
 }
 
 static bool checkValid (const std::string & check)
@@ -221,8 +861,5 @@ static bool checkValid (const std::string & check)
 
 static void lowerAll (std::string & text)
 {
-    for (size_t i = 0 ; i < text.size () ; ++ i)
-    {
-        text[i] = std::tolower (text[i]);
-    }
+    ByteKernels::lowerAll (&text[0] , text.size ());
 }
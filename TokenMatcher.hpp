@@ -0,0 +1,625 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_TOKENMATCHER_HPP
+#define CPPEX3_TOKENMATCHER_HPP
+//---------------DEFINES--------------
+#define TOKEN_BLOCK (64 << 10)
+
+#define TOKEN_SEPARATOR ' '
+
+#define TOKEN_HASH_BASE 0x100000001b3ULL
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "AhoCorasick.hpp"
+#include "BloomFilter.hpp"
+#include "ByteKernels.hpp"
+#include "FrozenHashMap.hpp"
+#include "HashMap.hpp"
+
+/**
+ * Matcher of whole tokens. A token is a maximal run of ASCII letters, digits and non ASCII
+ * bytes, anything else separates tokens, and a phrase matches a run of consecutive tokens of the
+ * text that are equal to its own tokens, ASCII case insensitive.
+ * Every phrase is stored as its tokens joined by TOKEN_SEPARATOR, and hashed by a polynomial
+ * rolling hash over the hashes of its tokens. The scanner hashes every token of the text once,
+ * then extends the window that ends at it one token to the left at a time, so probing the 1 to
+ * maxTokens () token windows costs one multiply and add each and never builds a string.
+ * Most windows are not phrases, so the matcher may keep a BloomFilter of the phrase hashes next
+ * to its table, that turns most of them away with a read of one cache line.
+ * The phrases never change once built, so they are frozen into a FrozenHashMap, one probe and
+ * one compare per window. Two distinct phrases with the same rolling hash can not be frozen, the
+ * phrases then stay in a chained HashMap.
+ */
+class TokenMatcher
+{
+public:
+    /**
+     * A token inside the buffer of a scanner
+     */
+    struct Token
+    {
+        /**
+         * position of the token in the buffer
+         */
+        size_t offset;
+        /**
+         * length of the token
+         */
+        size_t length;
+        /**
+         * StringHash of the token
+         */
+        size_t hash;
+    };
+
+    /**
+     * Consecutive tokens of a text, probed in the table as the phrase they spell
+     */
+    struct TokenWindow
+    {
+        /**
+         * buffer the tokens are in
+         */
+        const char *text;
+        /**
+         * first token of the window
+         */
+        const Token *first;
+        /**
+         * amount of tokens in the window
+         */
+        size_t count;
+        /**
+         * rolling hash of the window
+         */
+        size_t hash;
+    };
+
+    /**
+     * Rolling hash of phrases, a stored phrase is split at its separators, a window brings its
+     * hash along
+     */
+    struct WindowHash
+    {
+        typedef void is_transparent;
+
+        /**
+         * Hashes a stored phrase
+         * @param key Tokens joined by TOKEN_SEPARATOR
+         * @return Rolling hash of the tokens
+         */
+        size_t operator() (std::string_view key) const
+        {
+            size_t hash = 0;
+            size_t start = 0;
+            while (start <= key.size ())
+            {
+                size_t stop = std::min (key.find (TOKEN_SEPARATOR , start) , key.size ());
+                hash = hash * TOKEN_HASH_BASE + StringHash () (key.substr (start , stop - start));
+                start = stop + 1;
+            }
+            return hash;
+        }
+
+        /**
+         * Hash of a window
+         * @param window Window to hash
+         * @return Rolling hash of the window
+         */
+        size_t operator() (const TokenWindow & window) const
+        {
+            return window.hash;
+        }
+    };
+
+    /**
+     * Equality of a stored phrase with a phrase or a window
+     */
+    struct WindowEqual
+    {
+        typedef void is_transparent;
+
+        /**
+         * Compares two stored phrases
+         * @param key Stored phrase
+         * @param other Phrase to compare to
+         * @return true if equal false otherwise
+         */
+        bool operator() (const std::string & key , std::string_view other) const
+        {
+            return key == other;
+        }
+
+        /**
+         * Compares a stored phrase with the tokens of a window
+         * @param key Stored phrase
+         * @param window Window to compare to
+         * @return true if equal false otherwise
+         */
+        bool operator() (const std::string & key , const TokenWindow & window) const
+        {
+            size_t position = 0;
+            for (size_t i = 0 ; i < window.count ; ++ i)
+            {
+                const Token & token = window.first[i];
+                if (i != 0 && (position == key.size () || key[position ++] != TOKEN_SEPARATOR))
+                {
+                    return false;
+                }
+                if (key.size () - position < token.length ||
+                    std::memcmp (key.data () + position , window.text + token.offset ,
+                                 token.length) != 0)
+                {
+                    return false;
+                }
+                position += token.length;
+            }
+            return position == key.size ();
+        }
+    };
+
+    typedef HashMap<std::string , int , WindowHash , WindowEqual , true> WindowTable;
+
+    typedef FrozenHashMap<std::string , int , WindowHash , WindowEqual> FrozenWindowTable;
+
+    /**
+     * Def const, matches nothing
+     */
+    TokenMatcher () : _maxTokens (0) , _maxTokenLength (0)
+    {
+    }
+
+    /**
+     * Builds the matcher from the table, phrases with the same tokens add up their weights and
+     * phrases without any token are dropped
+     * @param table Table of patterns
+     * @param falsePositiveRate Rate of missing windows the filter lets through, 0 for no filter
+     */
+    explicit TokenMatcher (const PatternTable & table , double falsePositiveRate = 0) :
+            _maxTokens (0) , _maxTokenLength (0)
+    {
+        WindowTable windows;
+        windows.reserve (table.size ());
+        std::string phrase;
+        for (const auto & pair : table)
+        {
+            phrase = normalize (pair.first);
+            if (! phrase.empty ())
+            {
+                windows[phrase] += pair.second;
+                size_t tokens = (size_t) std::count (phrase.begin () , phrase.end () ,
+                                                     TOKEN_SEPARATOR) + 1;
+                _maxTokens = std::max (_maxTokens , tokens);
+                size_t start = 0;
+                while (start <= phrase.size ())
+                {
+                    size_t stop = std::min (phrase.find (TOKEN_SEPARATOR , start) , phrase.size ());
+                    _maxTokenLength = std::max (_maxTokenLength , stop - start);
+                    start = stop + 1;
+                }
+            }
+        }
+        if (falsePositiveRate > 0)
+        {
+            filter = BloomFilter ((size_t) windows.size () , falsePositiveRate);
+            for (const auto & pair : windows)
+            {
+                filter.insert (WindowHash () (pair.first));
+            }
+        }
+        try
+        {
+            frozen = FrozenWindowTable (windows);
+        }
+        catch (const buildException &)
+        {
+            chained = std::move (windows);
+        }
+    }
+
+    /**
+     * Checks if a lowered byte belongs to a token
+     * @param byte Byte to check
+     * @return true if part of a token false otherwise
+     */
+    static bool isTokenByte (unsigned char byte)
+    {
+        return (unsigned char) (byte - 'a') < 26 || (unsigned char) (byte - '0') < 10 ||
+               byte >= 0x80;
+    }
+
+    /**
+     * Lowers the phrase and joins its tokens by TOKEN_SEPARATOR
+     * @param phrase Phrase to normalize
+     * @return Tokens of the phrase, empty if it has none
+     */
+    static std::string normalize (std::string_view phrase)
+    {
+        std::string lowered (phrase);
+        ByteKernels::lowerAll (&lowered[0] , lowered.size ());
+        std::string joined;
+        size_t i = 0;
+        while (i < lowered.size ())
+        {
+            if (! isTokenByte ((unsigned char) lowered[i]))
+            {
+                ++ i;
+                continue;
+            }
+            if (! joined.empty ())
+            {
+                joined += TOKEN_SEPARATOR;
+            }
+            while (i < lowered.size () && isTokenByte ((unsigned char) lowered[i]))
+            {
+                joined += lowered[i ++];
+            }
+        }
+        return joined;
+    }
+
+    /**
+     * Amount of tokens of the longest phrase
+     * @return Amount of tokens of the longest phrase
+     */
+    size_t maxTokens () const
+    {
+        return _maxTokens;
+    }
+
+    /**
+     * Length of the longest token of any phrase, a longer token of a text matches nothing
+     * @return Length of the longest token of any phrase
+     */
+    size_t maxTokenLength () const
+    {
+        return _maxTokenLength;
+    }
+
+    /**
+     * Amount of distinct phrases
+     * @return Amount of distinct phrases
+     */
+    int size () const
+    {
+        return chained.empty () ? frozen.size () : chained.size ();
+    }
+
+    /**
+     * Checks if the phrases are in the frozen table
+     * @return true if frozen false if two phrases share a hash and they are in a HashMap
+     */
+    bool isFrozen () const
+    {
+        return chained.empty ();
+    }
+
+    /**
+     * Filter in front of the table
+     * @return The filter, empty if there is none
+     */
+    const BloomFilter & bloomFilter () const
+    {
+        return filter;
+    }
+
+    /**
+     * Scores a text chunk by chunk. Chunks are copied and lowered into a buffer one TOKEN_BLOCK
+     * at a time, and only the token cut by the end of a chunk and the tokens the next windows
+     * still need are kept from one block to the next, packed without the separators between
+     * them. A token longer than maxTokenLength () is in no phrase, so it ends every window before
+     * it and its bytes are skipped as they come: the buffer never holds more than a block and
+     * maxTokens () tokens of at most maxTokenLength () bytes.
+     */
+    class Scanner
+    {
+    public:
+        /**
+         * Constructor
+         * @param matcher Matcher to scan with, must outlive the scanner
+         * @param limit Score at which scanning stops, INT_MAX to scan everything
+         */
+        explicit Scanner (const TokenMatcher & matcher , int limit = INT_MAX) : matcher (matcher) ,
+                                                                               limit (limit) ,
+                                                                               cursor (0) ,
+                                                                               overlong (false) ,
+                                                                               sum (0) ,
+                                                                               _hits (0) ,
+                                                                               _misses (0) ,
+                                                                               _falsePositives (0)
+        {
+        }
+
+        /**
+         * Scans the next chunk of the text, stopping right after the token that makes the score
+         * reach the limit. A token running to the end of the chunk is scored once the next chunk
+         * or finish () ends it.
+         * @param text Chunk to scan
+         * @param length Length of the chunk
+         * @return Amount of bytes scanned
+         */
+        size_t feed (const char *text , size_t length)
+        {
+            size_t fed = 0;
+            while (fed < length && ! reached ())
+            {
+                size_t piece = std::min (length - fed , (size_t) TOKEN_BLOCK);
+                size_t start = buffer.size ();
+                buffer.append (text + fed , piece);
+                ByteKernels::lowerAll (&buffer[start] , piece);
+                size_t stop = _tokenize (false);
+                fed += reached () ? stop - start : piece;
+                _compact ();
+            }
+            return fed;
+        }
+
+        /**
+         * Ends the text, scoring the token cut by the end of the last chunk
+         */
+        void finish ()
+        {
+            if (! reached ())
+            {
+                _tokenize (true);
+            }
+        }
+
+        /**
+         * Checks if the score reached the limit
+         * @return true if reached false otherwise
+         */
+        bool reached () const
+        {
+            return sum >= limit;
+        }
+
+        /**
+         * Score of the text scanned so far
+         * @return Score of the text scanned so far
+         */
+        int score () const
+        {
+            return sum;
+        }
+
+        /**
+         * Amount of bytes kept in the buffer between chunks
+         * @return Size of the buffer
+         */
+        size_t buffered () const
+        {
+            return buffer.size ();
+        }
+
+        /**
+         * Amount of windows that are phrases
+         * @return Amount of windows found in the table
+         */
+        unsigned long long hits () const
+        {
+            return _hits;
+        }
+
+        /**
+         * Amount of windows that are not phrases
+         * @return Amount of windows not in the table, filtered or not
+         */
+        unsigned long long misses () const
+        {
+            return _misses;
+        }
+
+        /**
+         * Amount of windows that are not phrases but got through the filter, every miss when
+         * there is no filter
+         * @return Amount of windows probed in the table in vain
+         */
+        unsigned long long falsePositives () const
+        {
+            return _falsePositives;
+        }
+
+    private:
+        /**
+         * matcher to scan with
+         */
+        const TokenMatcher & matcher;
+        /**
+         * score at which scanning stops
+         */
+        int limit;
+        /**
+         * lowered text not dropped yet
+         */
+        std::string buffer;
+        /**
+         * tokens of the buffer, the last maxTokens () - 1 of them kept between blocks
+         */
+        std::vector<Token> tokens;
+        /**
+         * position of the buffer where tokenizing goes on
+         */
+        size_t cursor;
+        /**
+         * true while the cursor is inside a token longer than any phrase token
+         */
+        bool overlong;
+        /**
+         * score of the text scanned so far
+         */
+        int sum;
+        /**
+         * windows found in the table
+         */
+        unsigned long long _hits;
+        /**
+         * windows not in the table
+         */
+        unsigned long long _misses;
+        /**
+         * windows not in the table that got through the filter
+         */
+        unsigned long long _falsePositives;
+
+        /**
+         * Splits the buffer from the cursor into tokens and scores the windows ending at every
+         * one of them
+         * @param last true if the text ends with the buffer
+         * @return Position of the buffer where scanning stopped
+         */
+        size_t _tokenize (bool last)
+        {
+            const char *text = buffer.data ();
+            size_t size = buffer.size ();
+            while (overlong && cursor < size && isTokenByte ((unsigned char) text[cursor]))
+            {
+                ++ cursor;
+            }
+            overlong = overlong && cursor == size;
+            while (cursor < size)
+            {
+                if (! isTokenByte ((unsigned char) text[cursor]))
+                {
+                    ++ cursor;
+                    continue;
+                }
+                size_t end = cursor;
+                while (end < size && isTokenByte ((unsigned char) text[end]))
+                {
+                    ++ end;
+                }
+                if (end - cursor > matcher._maxTokenLength)
+                {
+                    // no window over this token is a phrase, so the windows before it end here,
+                    // and the rest of it in the next chunk is skipped without keeping its bytes
+                    tokens.clear ();
+                    overlong = end == size && ! last;
+                    cursor = end;
+                    continue;
+                }
+                if (end == size && ! last)
+                {
+                    // the next chunk may go on with this token
+                    return size;
+                }
+                tokens.push_back (Token {cursor , end - cursor ,
+                                         StringHash () (std::string_view (text + cursor ,
+                                                                          end - cursor))});
+                cursor = end;
+                if (_score ())
+                {
+                    return end;
+                }
+            }
+            return size;
+        }
+
+        /**
+         * Adds the weights of the phrases equal to a window ending at the last token
+         * @return true if the score reached the limit false otherwise
+         */
+        bool _score ()
+        {
+            size_t widest = std::min (tokens.size () , matcher._maxTokens);
+            const Token *last = tokens.data () + tokens.size () - 1;
+            size_t hash = 0;
+            size_t power = 1;
+            for (size_t count = 1 ; count <= widest ; ++ count)
+            {
+                // one more token on the left weighs one more power of the base
+                const Token *first = last - (count - 1);
+                hash += first->hash * power;
+                power *= TOKEN_HASH_BASE;
+                if (! matcher.filter.mayContain (hash))
+                {
+                    ++ _misses;
+                    continue;
+                }
+                const int *weight = matcher._weightOf (TokenWindow {buffer.data () , first ,
+                                                                     count , hash});
+                if (weight == nullptr)
+                {
+                    ++ _misses;
+                    ++ _falsePositives;
+                    continue;
+                }
+                ++ _hits;
+                sum += *weight;
+                if (reached ())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Drops the part of the buffer no window needs anymore, the kept tokens are packed at its
+         * front since windows compare tokens and not the separators between them
+         */
+        void _compact ()
+        {
+            size_t keep = matcher._maxTokens > 0 ? matcher._maxTokens - 1 : 0;
+            size_t dropTokens = tokens.size () > keep ? tokens.size () - keep : 0;
+            tokens.erase (tokens.begin () , tokens.begin () + dropTokens);
+            size_t packed = 0;
+            for (auto & token : tokens)
+            {
+                std::memmove (&buffer[packed] , buffer.data () + token.offset , token.length);
+                token.offset = packed;
+                packed += token.length;
+            }
+            buffer.erase (packed , cursor - packed);
+            cursor = packed;
+        }
+    };
+
+private:
+    /**
+     * the phrases and their weights
+     */
+    FrozenWindowTable frozen;
+    /**
+     * the phrases and their weights when they could not be frozen, empty otherwise
+     */
+    WindowTable chained;
+    /**
+     * filter of the hashes of the phrases, empty to probe the table with every window
+     */
+    BloomFilter filter;
+    /**
+     * amount of tokens of the longest phrase
+     */
+    size_t _maxTokens;
+    /**
+     * length of the longest token of any phrase
+     */
+    size_t _maxTokenLength;
+
+    /**
+     * Weight of the phrase a window spells
+     * @param window Window to look up
+     * @return Pointer to the weight, nullptr if the window is not a phrase
+     */
+    const int *_weightOf (const TokenWindow & window) const
+    {
+        if (chained.empty ())
+        {
+            auto found = frozen.find (window);
+            return found == frozen.end () ? nullptr : &found->second;
+        }
+        auto found = chained.find (window);
+        return found == chained.end () ? nullptr : &found->second;
+    }
+};
+
+#endif //CPPEX3_TOKENMATCHER_HPP
@@ -0,0 +1,155 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <vector>
+#include "../ArenaHashMap.hpp"
+#include "BenchUtils.hpp"
+
+/**
+ * Amount of phrases of the table
+ */
+static const int PHRASES = 1000000;
+
+/**
+ * Amount of calls to operator new so far
+ */
+static long allocations = 0;
+
+void *operator new (size_t size)
+{
+    ++ allocations;
+    void *memory = std::malloc (size == 0 ? 1 : size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc ();
+    }
+    return memory;
+}
+
+// the arena takes its blocks from the aligned form
+void *operator new (size_t size , std::align_val_t alignment)
+{
+    ++ allocations;
+    size_t align = (size_t) alignment;
+    void *memory = std::aligned_alloc (align , (size + align - 1) / align * align);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc ();
+    }
+    return memory;
+}
+
+void operator delete (void *memory , std::align_val_t) noexcept
+{
+    std::free (memory);
+}
+
+void operator delete (void *memory , size_t , std::align_val_t) noexcept
+{
+    std::free (memory);
+}
+
+// not inlined, so the compiler does not pair the free with an operator new it can not see
+__attribute__ ((noinline)) void operator delete (void *memory) noexcept
+{
+    std::free (memory);
+}
+
+__attribute__ ((noinline)) void operator delete (void *memory , size_t) noexcept
+{
+    std::free (memory);
+}
+
+/**
+ * Phrases of 4 to 11 spam words and a number, 30 to 80 bytes
+ * @return The phrases
+ */
+static std::vector<std::string> phrases ()
+{
+    const char *words[] = {"free" , "money" , "click" , "here" , "now" , "limited" , "offer" ,
+                           "winner" , "cheap" , "urgent" , "account" , "prize"};
+    std::mt19937 random (1);
+    std::vector<std::string> result;
+    for (int i = 0 ; i < PHRASES ; ++ i)
+    {
+        std::string phrase;
+        for (int j = 4 + (int) (random () % 8) ; j > 0 ; -- j)
+        {
+            phrase += words[random () % 12];
+            phrase += ' ';
+        }
+        result.push_back (phrase + std::to_string (i));
+    }
+    return result;
+}
+
+template<typename Map , typename Make>
+/**
+ * Builds a table of every phrase and destroys it
+ * @tparam Map type of the table
+ * @tparam Make type of the key maker
+ * @param name Name of the table
+ * @param keys Phrases to insert
+ * @param reserve true to presize the table
+ * @param make Makes the key of a phrase for the table
+ */
+static void run (const char *name , const std::vector<std::string> & keys , bool reserve ,
+                 Make make)
+{
+    long before = allocations;
+    Map *map = nullptr;
+    double build = timeMs ([&] ()
+                           {
+                               map = new Map ();
+                               if (reserve)
+                               {
+                                   map->reserve ((int) keys.size ());
+                               }
+                               for (const auto & key : keys)
+                               {
+                                   map->try_emplace (make (*map , key) , 1);
+                               }
+                           });
+    long built = allocations - before;
+    double destroy = timeMs ([&] ()
+                             { delete map; });
+    std::printf ("%-18s build %6.0f ms  destroy %5.0f ms  %9ld allocations\n" , name , build ,
+                 destroy , built);
+}
+
+/**
+ * Runs one table per process, since a table built after another one reuses the pages the first
+ * one freed and looks faster: ArenaHashMapBench default|reserve|arena
+ */
+int main (int argc , char *argv[])
+{
+    std::string table = argc > 1 ? argv[1] : "";
+    if (table != "default" && table != "reserve" && table != "arena")
+    {
+        std::fprintf (stderr , "Usage: ArenaHashMapBench default|reserve|arena\n");
+        return EXIT_FAILURE;
+    }
+    std::vector<std::string> keys = phrases ();
+    auto plain = [] (const HashMap<std::string , int> & , const std::string & key)
+    { return key; };
+    if (table == "arena")
+    {
+        run<ArenaHashMap<std::pmr::string , int>> ("ArenaHashMap" , keys , true ,
+                                                   [] (const ArenaHashMap<std::pmr::string , int> & map ,
+                                                       const std::string & key)
+                                                   {
+                                                       return std::pmr::string (key ,
+                                                                                map.get_allocator ());
+                                                   });
+    }
+    else
+    {
+        run<HashMap<std::string , int>> (table == "reserve" ? "default + reserve" : "default" , keys ,
+                                         table == "reserve" , plain);
+    }
+    return 0;
+}
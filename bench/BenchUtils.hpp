@@ -0,0 +1,62 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_BENCHUTILS_HPP
+#define CPPEX3_BENCHUTILS_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+template<typename F>
+/**
+ * Runs the callback once and times it
+ * @tparam F type of the callback
+ * @param callback Work to time
+ * @return Milliseconds taken
+ */
+double timeMs (F callback)
+{
+    auto start = std::chrono::steady_clock::now ();
+    callback ();
+    return std::chrono::duration<double , std::milli> (std::chrono::steady_clock::now () - start)
+            .count ();
+}
+
+/**
+ * Random lower case keys, of 4 to 23 bytes like the phrases of a database
+ * @param amount Amount of keys
+ * @param seed Seed of the keys
+ * @return The keys
+ */
+inline std::vector<std::string> randomKeys (size_t amount , unsigned seed)
+{
+    std::mt19937 random (seed);
+    std::vector<std::string> keys (amount);
+    for (auto & key : keys)
+    {
+        key.resize (4 + random () % 20);
+        for (auto & c : key)
+        {
+            c = (char) ('a' + random () % 26);
+        }
+    }
+    return keys;
+}
+
+/**
+ * Keeps a result alive, so the work that computed it is not optimized away
+ * @param result Result to keep
+ */
+inline void keep (long long result)
+{
+    if (result == - 1)
+    {
+        std::puts ("");
+    }
+}
+
+#endif //CPPEX3_BENCHUTILS_HPP
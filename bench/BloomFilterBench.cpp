@@ -0,0 +1,107 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "../BloomFilter.hpp"
+#include "../TokenMatcher.hpp"
+#include "BenchUtils.hpp"
+
+/**
+ * Amount of distinct words of the messages, the phrases use the first tenth of them
+ */
+static const int WORDS = 200000;
+
+/**
+ * Size of the message
+ */
+static const size_t MESSAGE_BYTES = 30 << 20;
+
+/**
+ * Observed false positive rate of the filter for some asked rates
+ */
+static void rates ()
+{
+    const size_t keys = 200000;
+    const size_t probes = 2000000;
+    for (double rate : {0.01 , 0.001 , 0.0001})
+    {
+        BloomFilter filter (keys , rate);
+        std::mt19937_64 random (1);
+        for (size_t i = 0 ; i < keys ; ++ i)
+        {
+            filter.insert ((size_t) random ());
+        }
+        size_t passed = 0;
+        for (size_t i = 0 ; i < probes ; ++ i)
+        {
+            passed += filter.mayContain ((size_t) random ());
+        }
+        std::printf ("rate %-7g observed %.5f  %.1f bits per key  %d hashes\n" , rate ,
+                     (double) passed / probes , (double) filter.bits () / keys , filter.hashes ());
+    }
+}
+
+/**
+ * Scans a message of random words in token mode with and without a filter
+ * @param phrases Amount of phrases of the database
+ */
+static void scan (int phrases)
+{
+    std::vector<std::string> words = randomKeys (WORDS , 5);
+    for (auto & word : words)
+    {
+        word.resize (3 + word.size () % 7);
+    }
+    std::mt19937 random (5);
+    PatternTable table;
+    for (int i = 0 ; i < phrases ; ++ i)
+    {
+        std::string phrase = words[random () % (WORDS / 10)];
+        for (int extra = (int) (random () % 3) ; extra > 0 ; -- extra)
+        {
+            phrase += " " + words[random () % (WORDS / 10)];
+        }
+        table.insert (phrase , 1);
+    }
+    std::string message;
+    while (message.size () < MESSAGE_BYTES)
+    {
+        message += words[random () % WORDS];
+        message += ' ';
+    }
+    for (double rate : {0.0 , 0.01})
+    {
+        TokenMatcher matcher (table , rate);
+        TokenMatcher::Scanner scanner (matcher);
+        double time = timeMs ([&] ()
+                              {
+                                  scanner.feed (message.data () , message.size ());
+                                  scanner.finish ();
+                              });
+        std::printf ("%8d phrases  filter %-5g %6.0f ms  hits %llu  misses %llu" , matcher.size () ,
+                     rate , time , scanner.hits () , scanner.misses ());
+        std::printf ("  probed in vain %llu\n" , scanner.falsePositives ());
+    }
+}
+
+/**
+ * BloomFilterBench [phrases...], scans with 20000 and 1500000 phrases (less once repeats are
+ * merged) when none are given
+ */
+int main (int argc , char *argv[])
+{
+    rates ();
+    if (argc == 1)
+    {
+        scan (20000);
+        scan (1500000);
+    }
+    for (int i = 1 ; i < argc ; ++ i)
+    {
+        scan (std::atoi (argv[i]));
+    }
+    return 0;
+}
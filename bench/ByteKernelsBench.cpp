@@ -0,0 +1,105 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <random>
+#include <string>
+#include "../AhoCorasick.hpp"
+#include "../ByteKernels.hpp"
+#include "BenchUtils.hpp"
+
+/**
+ * Size of the text
+ */
+static const size_t TEXT_BYTES = 64 << 20;
+
+/**
+ * English like text of common words, one letter in eight upper case
+ * @return The text
+ */
+static std::string englishText ()
+{
+    const char *words[] = {"the" , "of" , "and" , "to" , "in" , "is" , "that" , "for" , "it" , "as" ,
+                           "was" , "with" , "be" , "by" , "on" , "not" , "he" , "this" , "are" ,
+                           "or"};
+    std::mt19937 random (1);
+    std::string text (TEXT_BYTES , ' ');
+    for (size_t i = 0 ; i < TEXT_BYTES ; )
+    {
+        for (const char *c = words[random () % 20] ; *c != '\0' && i < TEXT_BYTES ; ++ c)
+        {
+            text[i ++] = random () % 8 ? *c : (char) (*c - 'a' + 'A');
+        }
+        if (i < TEXT_BYTES)
+        {
+            text[i ++] = ' ';
+        }
+    }
+    return text;
+}
+
+/**
+ * Set of the given bytes
+ * @param bytes Members of the set
+ * @return The set
+ */
+static ByteSet setOf (const std::string & bytes)
+{
+    bool member[BYTE_VALUES] = {};
+    for (char c : bytes)
+    {
+        member[(unsigned char) c] = true;
+    }
+    return ByteKernels::makeSet (member);
+}
+
+/**
+ * Throughput of work over the whole text
+ * @param milliseconds Time taken
+ * @return GB per second
+ */
+static double gbPerSecond (double milliseconds)
+{
+    return (double) TEXT_BYTES / milliseconds / 1e6;
+}
+
+int main ()
+{
+    std::string text = englishText ();
+    // none of the bytes of the sets are in the text, so every find scans all of it
+    ByteSet few = setOf ("$#@%");
+    ByteSet many = setOf ("jkqvxzJKQVXZ01234567");
+    ByteSet followers = setOf ("!?");
+    PatternTable table;
+    table.insert ("viagra" , 5);
+    table.insert ("lottery" , 3);
+    table.insert ("winner" , 2);
+    table.insert ("free money" , 4);
+    table.insert ("xxx" , 1);
+    AhoCorasick matcher (table);
+    const char *names[] = {"scalar" , "sse2" , "avx2" , "avx512"};
+    std::printf ("GB/s    lower  findAny4  findAny20  findPair  score\n");
+    for (int level = KERNEL_SCALAR ; level <= ByteKernels::supported () ; ++ level)
+    {
+        ByteKernels::setLevel (level);
+        std::string copy = text;
+        long long found = 0;
+        double lower = timeMs ([&] ()
+                               { ByteKernels::lowerAll (&copy[0] , copy.size ()); });
+        double anyFew = timeMs ([&] ()
+                                { found += ByteKernels::findAny (text.data () , text.size () , few); });
+        double anyMany = timeMs ([&] ()
+                                 { found += ByteKernels::findAny (text.data () , text.size () , many); });
+        double pair = timeMs ([&] ()
+                              {
+                                  found += ByteKernels::findPair (text.data () , text.size () , many ,
+                                                                  &followers);
+                              });
+        double score = timeMs ([&] ()
+                               { found += matcher.score (text); });
+        keep (found + copy[0]);
+        std::printf ("%-7s %5.2f %9.2f %10.2f %9.2f %6.2f\n" , names[level] , gbPerSecond (lower) ,
+                     gbPerSecond (anyFew) , gbPerSecond (anyMany) , gbPerSecond (pair) ,
+                     gbPerSecond (score));
+    }
+    return 0;
+}
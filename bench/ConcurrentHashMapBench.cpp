@@ -0,0 +1,176 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "../ConcurrentHashMap.hpp"
+
+/**
+ * Amount of operations of every run, split over its threads
+ */
+static const int OPERATIONS = 2000000;
+
+/**
+ * Amount of distinct keys, half of them are in the map at the start
+ */
+static const int KEYS = 100000;
+
+/**
+ * One HashMap behind one reader writer lock, what the sharded maps are compared to
+ */
+struct GlobalLockMap
+{
+    mutable std::shared_mutex mutex;
+    HashMap<int , int> map;
+
+    bool find (int key , int & value) const
+    {
+        std::shared_lock<std::shared_mutex> lock (mutex);
+        auto found = map.find (key);
+        if (found == map.end ())
+        {
+            return false;
+        }
+        value = found->second;
+        return true;
+    }
+
+    void insert (int key , int value)
+    {
+        std::unique_lock<std::shared_mutex> lock (mutex);
+        map.insert (key , value);
+    }
+
+    void erase (int key)
+    {
+        std::unique_lock<std::shared_mutex> lock (mutex);
+        map.erase (key);
+    }
+};
+
+/**
+ * HashMaps behind one reader writer lock per shard, the map before its reads turned optimistic
+ */
+struct LockedShardMap
+{
+    struct alignas (CACHE_LINE) Slot
+    {
+        mutable std::shared_mutex mutex;
+        HashMap<int , int> map;
+    };
+
+    Slot slots[CONCURRENT_SHARDS];
+
+    Slot & slotOf (int key)
+    {
+        return slots[mixHash ((uint64_t) key) % CONCURRENT_SHARDS];
+    }
+
+    bool find (int key , int & value)
+    {
+        Slot & slot = slotOf (key);
+        std::shared_lock<std::shared_mutex> lock (slot.mutex);
+        auto found = slot.map.find (key);
+        if (found == slot.map.end ())
+        {
+            return false;
+        }
+        value = found->second;
+        return true;
+    }
+
+    void insert (int key , int value)
+    {
+        Slot & slot = slotOf (key);
+        std::unique_lock<std::shared_mutex> lock (slot.mutex);
+        slot.map.insert (key , value);
+    }
+
+    void erase (int key)
+    {
+        Slot & slot = slotOf (key);
+        std::unique_lock<std::shared_mutex> lock (slot.mutex);
+        slot.map.erase (key);
+    }
+};
+
+template<typename Map>
+/**
+ * Runs random finds, inserts and erases from many threads
+ * @tparam Map type of the map
+ * @param map Map to run on
+ * @param threads Amount of threads
+ * @param writePercent Percent of the operations that insert or erase
+ * @return Milliseconds taken
+ */
+static double run (Map & map , int threads , int writePercent)
+{
+    for (int i = 0 ; i < KEYS ; i += 2)
+    {
+        map.insert (i , i);
+    }
+    auto start = std::chrono::steady_clock::now ();
+    std::vector<std::thread> workers;
+    for (int t = 0 ; t < threads ; ++ t)
+    {
+        workers.emplace_back ([&map , threads , writePercent , t] ()
+                              {
+                                  std::mt19937 random (t);
+                                  long sum = 0;
+                                  for (int i = 0 ; i < OPERATIONS / threads ; ++ i)
+                                  {
+                                      int key = (int) (random () % KEYS);
+                                      int value = 0;
+                                      if ((int) (random () % 100) >= writePercent)
+                                      {
+                                          sum += map.find (key , value) ? value : 0;
+                                      }
+                                      else if (random () & 1)
+                                      {
+                                          map.insert (key , i);
+                                      }
+                                      else
+                                      {
+                                          map.erase (key);
+                                      }
+                                  }
+                                  // keeps the finds from being optimized away
+                                  if (sum == - 1)
+                                  {
+                                      std::puts ("");
+                                  }
+                              });
+    }
+    for (auto & worker : workers)
+    {
+        worker.join ();
+    }
+    return std::chrono::duration<double , std::milli> (std::chrono::steady_clock::now () - start)
+            .count ();
+}
+
+int main ()
+{
+    std::printf ("writes threads  optimistic ms  locked shards ms  one lock ms\n");
+    for (int writePercent : {5 , 50})
+    {
+        for (int threads : {1 , 2 , 4 , 8})
+        {
+            ConcurrentHashMap<int , int> optimistic;
+            std::unique_ptr<LockedShardMap> locked (new LockedShardMap ());
+            GlobalLockMap global;
+            double optimisticTime = run (optimistic , threads , writePercent);
+            double lockedTime = run (*locked , threads , writePercent);
+            double globalTime = run (global , threads , writePercent);
+            std::printf ("%5d%% %7d %14.0f %17.0f %12.0f\n" , writePercent , threads ,
+                         optimisticTime , lockedTime , globalTime);
+        }
+    }
+    return 0;
+}
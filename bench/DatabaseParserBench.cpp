@@ -0,0 +1,84 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <boost/tokenizer.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../DatabaseParser.hpp"
+#include "BenchUtils.hpp"
+
+/**
+ * Amount of lines of the database
+ */
+static const int LINES = 2000000;
+
+typedef boost::tokenizer<boost::char_separator<char>> Tok;
+
+/**
+ * The loading of the database before DatabaseParser: getline, tokenizer and stoi per line
+ * @param data Database to parse
+ * @param entries Filled with the phrases and scores
+ * @return true if invalid false otherwise
+ */
+static bool tokenizerParse (const std::string & data ,
+                            std::vector<std::pair<std::string , int>> & entries)
+{
+    std::istringstream in (data);
+    std::string line;
+    boost::char_separator<char> sep {","};
+    while (getline (in , line))
+    {
+        Tok tok {line , sep};
+        if (line.find_first_of (',') != line.find_last_of (',') ||
+            line.find_first_of (',') == std::string::npos || line.size () == 1)
+        {
+            return true;
+        }
+        int count = 0;
+        for (auto i = tok.begin () ; i != tok.end () ; ++ i)
+        {
+            ++ count;
+        }
+        if (count != 2)
+        {
+            return true;
+        }
+        entries.emplace_back (*tok.begin () , std::stoi (*(++ tok.begin ())));
+    }
+    return false;
+}
+
+int main ()
+{
+    std::vector<std::string> phrases = randomKeys (LINES , 3);
+    std::string data;
+    for (int i = 0 ; i < LINES ; ++ i)
+    {
+        data += phrases[i] + "," + std::to_string (i % 100) + "\n";
+    }
+    std::vector<std::pair<std::string , int>> old;
+    double before = timeMs ([&] ()
+                            { tokenizerParse (data , old); });
+    std::vector<DatabaseParser::Entry> entries;
+    double single = timeMs ([&] ()
+                            { DatabaseParser::parse (data.data () , data.size () , entries); });
+    std::printf ("%d lines, %.1f MB\n" , LINES , (double) data.size () / (1 << 20));
+    std::printf ("getline + tokenizer       %7.0f ms\n" , before);
+    std::printf ("DatabaseParser            %7.0f ms\n" , single);
+    unsigned int threads = std::thread::hardware_concurrency ();
+    if (threads > 1)
+    {
+        // a fresh vector, so both runs pay for growing it
+        std::vector<DatabaseParser::Entry> parallel;
+        double time = timeMs ([&] ()
+                              {
+                                  DatabaseParser::parse (data.data () , data.size () , parallel ,
+                                                         threads);
+                              });
+        std::printf ("DatabaseParser %2u threads %7.0f ms\n" , threads , time);
+    }
+    keep ((long long) (old.size () + entries.size ()));
+    return 0;
+}
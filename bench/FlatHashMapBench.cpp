@@ -0,0 +1,75 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "../FlatHashMap.hpp"
+#include "BenchUtils.hpp"
+
+/**
+ * Amount of keys of every run
+ */
+static const size_t KEYS = 2000000;
+
+template<typename Map , typename Key>
+/**
+ * Inserts, then finds present and missing keys, and prints the throughput
+ * @tparam Map type of the map
+ * @tparam Key type of the keys
+ * @param name Name of the run
+ * @param keys Keys to insert
+ * @param missing Keys to look for that are not inserted
+ */
+static void run (const char *name , const std::vector<Key> & keys ,
+                 const std::vector<Key> & missing)
+{
+    Map map;
+    double insert = timeMs ([&] ()
+                            {
+                                for (size_t i = 0 ; i < keys.size () ; ++ i)
+                                {
+                                    map.insert (keys[i] , (int) i);
+                                }
+                            });
+    long long found = 0;
+    double hit = timeMs ([&] ()
+                         {
+                             for (const auto & key : keys)
+                             {
+                                 found += map.containsKey (key);
+                             }
+                         });
+    double miss = timeMs ([&] ()
+                          {
+                              for (const auto & key : missing)
+                              {
+                                  found += map.containsKey (key);
+                              }
+                          });
+    keep (found);
+    double mops = keys.size () / 1000.0;
+    std::printf ("%-24s insert %5.2f Mops/s  hit %5.2f Mops/s  miss %5.2f Mops/s\n" , name ,
+                 mops / insert , mops / hit , mops / miss);
+}
+
+int main ()
+{
+    std::vector<std::string> keys = randomKeys (KEYS , 1);
+    std::vector<std::string> missing = randomKeys (KEYS , 2);
+    run<HashMap<std::string , int , StringHash>> ("HashMap string" , keys , missing);
+    run<FlatHashMap<std::string , int , StringHash>> ("FlatHashMap string" , keys , missing);
+    // a shuffle of distinct keys, the first half is inserted and the second half is missing
+    std::vector<int> shuffled (2 * KEYS);
+    for (size_t i = 0 ; i < shuffled.size () ; ++ i)
+    {
+        shuffled[i] = (int) i;
+    }
+    std::shuffle (shuffled.begin () , shuffled.end () , std::mt19937 (3));
+    std::vector<int> numbers (shuffled.begin () , shuffled.begin () + KEYS);
+    std::vector<int> absent (shuffled.begin () + KEYS , shuffled.end ());
+    run<HashMap<int , int>> ("HashMap int" , numbers , absent);
+    run<FlatHashMap<int , int>> ("FlatHashMap int" , numbers , absent);
+    return 0;
+}
@@ -0,0 +1,121 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "../HashMap.hpp"
+#include "BenchUtils.hpp"
+
+/**
+ * Amount of string keys of the insert and lookup runs
+ */
+static const size_t KEYS = 2000000;
+
+/**
+ * Iterates the few pairs left in a map of many buckets, which the occupancy bitmap skips a word
+ * at a time
+ */
+static void sparseIteration ()
+{
+    HashMap<int , int> map;
+    map.setAutoShrink (false);
+    for (int i = 0 ; i < (int) KEYS ; ++ i)
+    {
+        map.insert (i , i);
+    }
+    for (int i = 10 ; i < (int) KEYS ; ++ i)
+    {
+        map.erase (i);
+    }
+    long long sum = 0;
+    double time = timeMs ([&] ()
+                          {
+                              for (int round = 0 ; round < 100 ; ++ round)
+                              {
+                                  for (const auto & pair : map)
+                                  {
+                                      sum += pair.second;
+                                  }
+                              }
+                          });
+    keep (sum);
+    std::printf ("iterate %d pairs in %d buckets 100 times: %.1f ms\n" , map.size () ,
+                 map.capacity () , time);
+}
+
+/**
+ * Longest single insert while growing, with every rehash done at once or spread over inserts
+ * @param keys Keys to insert
+ */
+static void longestInsert (const std::vector<std::string> & keys)
+{
+    // both maps live to the end, freeing the first one would make malloc sort its 2M chunks in
+    // the middle of the inserts into the second one
+    HashMap<std::string , int , StringHash> maps[2];
+    for (bool incremental : {false , true})
+    {
+        HashMap<std::string , int , StringHash> & map = maps[incremental];
+        map.setIncrementalRehash (incremental);
+        double longest = 0;
+        for (size_t i = 0 ; i < keys.size () ; ++ i)
+        {
+            longest = std::max (longest , timeMs ([&] ()
+                                                  { map.insert (keys[i] , (int) i); }));
+        }
+        std::printf ("%-11s rehash: longest insert %.1f ms\n" ,
+                     incremental ? "incremental" : "full" , longest);
+    }
+}
+
+template<typename Hash , bool CacheHash>
+/**
+ * Inserts, then finds present and missing keys
+ * @tparam Hash type of the hash
+ * @tparam CacheHash true to store the hash of every key
+ * @param name Name of the run
+ * @param keys Keys to insert
+ * @param missing Keys to look for that are not inserted
+ */
+static void lookups (const char *name , const std::vector<std::string> & keys ,
+                     const std::vector<std::string> & missing)
+{
+    HashMap<std::string , int , Hash , std::equal_to<> , CacheHash> map;
+    double insert = timeMs ([&] ()
+                            {
+                                for (size_t i = 0 ; i < keys.size () ; ++ i)
+                                {
+                                    map.insert (keys[i] , (int) i);
+                                }
+                            });
+    long long found = 0;
+    double hit = timeMs ([&] ()
+                         {
+                             for (const auto & key : keys)
+                             {
+                                 found += map.containsKey (key);
+                             }
+                         });
+    double miss = timeMs ([&] ()
+                          {
+                              for (const auto & key : missing)
+                              {
+                                  found += map.containsKey (key);
+                              }
+                          });
+    keep (found);
+    std::printf ("%-18s insert %5.0f ms  hit %5.0f ms  miss %5.0f ms\n" , name , insert , hit ,
+                 miss);
+}
+
+int main ()
+{
+    sparseIteration ();
+    std::vector<std::string> keys = randomKeys (KEYS , 1);
+    std::vector<std::string> missing = randomKeys (KEYS , 2);
+    longestInsert (keys);
+    lookups<KeyHash<std::string> , false> ("std::hash" , keys , missing);
+    lookups<StringHash , false> ("StringHash" , keys , missing);
+    lookups<StringHash , true> ("StringHash + cache" , keys , missing);
+    return 0;
+}
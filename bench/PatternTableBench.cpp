@@ -0,0 +1,62 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <string>
+#include <string_view>
+#include "../InternedStringMap.hpp"
+#include "BenchUtils.hpp"
+
+/**
+ * Amount of keys of the table
+ */
+static const size_t KEYS = 1000000;
+
+/**
+ * Amount of lookups, two thirds hit and one third miss
+ */
+static const size_t LOOKUPS = 3000000;
+
+template<typename Map>
+/**
+ * Builds the table and looks keys up in it
+ * @tparam Map type of the table
+ * @param name Name of the table
+ * @param keys Keys to insert
+ * @param probes Keys to look up
+ */
+static void run (const char *name , const std::vector<std::string> & keys ,
+                 const std::vector<std::string> & probes)
+{
+    Map map;
+    double build = timeMs ([&] ()
+                           {
+                               for (size_t i = 0 ; i < keys.size () ; ++ i)
+                               {
+                                   map.insert (keys[i] , (int) i);
+                               }
+                           });
+    long long found = 0;
+    double lookup = timeMs ([&] ()
+                            {
+                                for (const auto & probe : probes)
+                                {
+                                    found += map.containsKey (std::string_view (probe));
+                                }
+                            });
+    keep (found);
+    std::printf ("%-20s build %7.0f ms  lookups %7.0f ms\n" , name , build , lookup);
+}
+
+int main ()
+{
+    std::vector<std::string> keys = randomKeys (KEYS , 1);
+    std::vector<std::string> misses = randomKeys (LOOKUPS / 3 , 2);
+    std::vector<std::string> probes;
+    for (size_t i = 0 ; i < LOOKUPS ; ++ i)
+    {
+        probes.push_back (i % 3 == 2 ? misses[i / 3] : keys[(i * 7919) % KEYS]);
+    }
+    run<HashMap<std::string , int , StringHash>> ("HashMap" , keys , probes);
+    run<InternedStringMap<int>> ("InternedStringMap" , keys , probes);
+    return 0;
+}
@@ -0,0 +1,76 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <random>
+#include <string>
+#include <vector>
+#include "../AhoCorasick.hpp"
+#include "../TokenMatcher.hpp"
+#include "BenchUtils.hpp"
+
+/**
+ * Amount of phrases of the database
+ */
+static const int PHRASES = 20000;
+
+/**
+ * Amount of distinct words the phrases and the message are made of
+ */
+static const int WORDS = 5000;
+
+/**
+ * Size of the message
+ */
+static const size_t MESSAGE_BYTES = 60 << 20;
+
+int main ()
+{
+    std::vector<std::string> words = randomKeys (WORDS , 4);
+    for (auto & word : words)
+    {
+        word.resize (3 + word.size () % 6);
+    }
+    std::mt19937 random (5);
+    PatternTable table;
+    for (int i = 0 ; i < PHRASES ; ++ i)
+    {
+        std::string phrase = words[random () % WORDS];
+        for (int extra = (int) (random () % 3) ; extra > 0 ; -- extra)
+        {
+            phrase += " " + words[random () % WORDS];
+        }
+        table.insert (phrase , 1 + (int) (random () % 5));
+    }
+    std::string message;
+    while (message.size () < MESSAGE_BYTES)
+    {
+        message += words[random () % WORDS];
+        message += random () % 10 ? " " : ", ";
+    }
+    int substringScore = 0;
+    int tokenScore = 0;
+    AhoCorasick *automaton = nullptr;
+    TokenMatcher *tokens = nullptr;
+    double automatonBuild = timeMs ([&] ()
+                                    { automaton = new AhoCorasick (table); });
+    double tokenBuild = timeMs ([&] ()
+                                { tokens = new TokenMatcher (table); });
+    double substringScan = timeMs ([&] ()
+                                   { substringScore = automaton->score (message); });
+    double tokenScan = timeMs ([&] ()
+                               {
+                                   TokenMatcher::Scanner scanner (*tokens);
+                                   scanner.feed (message.data () , message.size ());
+                                   scanner.finish ();
+                                   tokenScore = scanner.score ();
+                               });
+    std::printf ("%d phrases of 1 to 3 words, %.0f MB message\n" , PHRASES ,
+                 (double) message.size () / (1 << 20));
+    std::printf ("substring  build %6.0f ms  scan %6.0f ms  score %d\n" , automatonBuild ,
+                 substringScan , substringScore);
+    std::printf ("token      build %6.0f ms  scan %6.0f ms  score %d\n" , tokenBuild , tokenScan ,
+                 tokenScore);
+    delete automaton;
+    delete tokens;
+    return 0;
+}
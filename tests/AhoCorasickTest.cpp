@@ -0,0 +1,146 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <cstdlib>
+#include <new>
+#include <string>
+#include "../AhoCorasick.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * Amount of calls to operator new so far
+ */
+static int allocations = 0;
+
+void *operator new (size_t size)
+{
+    ++ allocations;
+    void *memory = std::malloc (size == 0 ? 1 : size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc ();
+    }
+    return memory;
+}
+
+// not inlined, so the compiler does not pair the free with an operator new it can not see
+__attribute__ ((noinline)) void operator delete (void *memory) noexcept
+{
+    std::free (memory);
+}
+
+__attribute__ ((noinline)) void operator delete (void *memory , size_t) noexcept
+{
+    std::free (memory);
+}
+
+/**
+ * Sums the weights of every appearance of every pattern, one find at a time
+ * @param table Patterns and weights, lower case
+ * @param text Text to score
+ * @return Score of the text
+ */
+static int naiveScore (const PatternTable & table , std::string text)
+{
+    for (auto & c : text)
+    {
+        c = (char) std::tolower ((unsigned char) c);
+    }
+    int score = 0;
+    for (const auto & pair : table)
+    {
+        for (size_t at = text.find (pair.first) ; at != std::string::npos ;
+             at = text.find (pair.first , at + 1))
+        {
+            score += pair.second;
+        }
+    }
+    return score;
+}
+
+/**
+ * Overlapping appearances are all counted, case insensitive, the same in chunks
+ */
+static void testScore ()
+{
+    PatternTable table;
+    table.insert ("aa" , 1);
+    table.insert ("aba" , 2);
+    table.insert ("b" , 5);
+    table.insert ("buy now" , 7);
+    AhoCorasick matcher (table);
+    const std::string texts[] = {"" , "aaaa" , "ABABA" , "Buy NOW buy now!" , "xyz" , "abaaba"};
+    for (const auto & text : texts)
+    {
+        CHECK (matcher.score (text) == naiveScore (table , text));
+        AhoCorasick::Scanner scanner (matcher);
+        for (char c : text)
+        {
+            scanner.feed (&c , 1);
+        }
+        CHECK (scanner.score () == naiveScore (table , text));
+    }
+    AhoCorasick::Scanner limited (matcher , 3);
+    CHECK (limited.feed ("aaaaaaaa" , 8) == 4);
+    CHECK (limited.reached ());
+}
+
+/**
+ * A pattern of every byte takes the most byte classes there can be, upper case letters share
+ * the class of their lower case letter
+ */
+static void testEveryByte ()
+{
+    PatternTable table;
+    std::string every;
+    for (int c = 0 ; c < ALPHABET_SIZE ; ++ c)
+    {
+        if (c < 'A' || c > 'Z')
+        {
+            every += (char) c;
+        }
+    }
+    table.insert (every , 1);
+    table.insert (std::string (1 , '\0') + "a" , 2);
+    AhoCorasick matcher (table);
+    CHECK (matcher.classes () == ALPHABET_SIZE - ('Z' - 'A' + 1) + 1);
+    CHECK (matcher.score (every + every) == 2);
+    std::string upper = every;
+    for (auto & c : upper)
+    {
+        c = (char) std::toupper ((unsigned char) c);
+    }
+    CHECK (matcher.score (upper) == 1);
+    std::string nulA = std::string (1 , '\0') + "A";
+    CHECK (matcher.score (nulA) == naiveScore (table , nulA));
+}
+
+/**
+ * The empty automaton, a view over arrays that live elsewhere (as the embedded database does)
+ * and scanning with it allocate nothing
+ */
+static void testViewAllocatesNothing ()
+{
+    PatternTable table;
+    table.insert ("free" , 3);
+    table.insert ("buy now" , 5);
+    AhoCorasick compiled (table);
+    int before = allocations;
+    AhoCorasick matcher;
+    CHECK (matcher.score ("anything") == 0);
+    matcher = AhoCorasick (compiled.classes () , compiled.states () , compiled.classTable () ,
+                           compiled.transitions () , compiled.weights ());
+    AhoCorasick::Scanner scanner (matcher , 100);
+    const char text[] = "Buy now, it is free! FREE!";
+    scanner.feed (text , sizeof (text) - 1);
+    CHECK (allocations == before);
+    CHECK (scanner.score () == 11);
+}
+
+int main ()
+{
+    testScore ();
+    testEveryByte ();
+    testViewAllocatesNothing ();
+    return testResult ();
+}
@@ -0,0 +1,147 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../ArenaHashMap.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * Amount of calls to operator new so far
+ */
+static int allocations = 0;
+
+void *operator new (size_t size)
+{
+    ++ allocations;
+    void *memory = std::malloc (size == 0 ? 1 : size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc ();
+    }
+    return memory;
+}
+
+// not inlined, so the compiler does not pair the free with an operator new it can not see
+__attribute__ ((noinline)) void operator delete (void *memory) noexcept
+{
+    std::free (memory);
+}
+
+__attribute__ ((noinline)) void operator delete (void *memory , size_t) noexcept
+{
+    std::free (memory);
+}
+
+typedef ArenaHashMap<std::pmr::string , int , StringHash , std::equal_to<> , true> CachedArenaMap;
+
+typedef HashMap<std::pmr::string , int , StringHash , std::equal_to<> , true ,
+        std::pmr::polymorphic_allocator<std::pair<std::pmr::string , int>>> CachedArenaBase;
+
+/**
+ * Keys built on the arena of the map take their bytes from it too, so a presized build costs a
+ * few block allocations however many keys it holds
+ */
+static void testBuildAllocatesBlocks ()
+{
+    std::vector<std::string> keys;
+    for (int i = 0 ; i < 1000 ; ++ i)
+    {
+        keys.push_back ("a phrase too long for the small buffer " + std::to_string (i));
+    }
+    ArenaHashMap<std::pmr::string , int , StringHash> map;
+    map.reserve ((int) keys.size ());
+    int before = allocations;
+    for (size_t i = 0 ; i < keys.size () ; ++ i)
+    {
+        map.try_emplace (std::pmr::string (keys[i] , map.get_allocator ()) , (int) i);
+    }
+    CHECK (allocations - before < 20);
+    bool found = true;
+    for (size_t i = 0 ; i < keys.size () ; ++ i)
+    {
+        found = found && map.at (std::string_view (keys[i])) == (int) i;
+    }
+    CHECK (found);
+    CHECK (map.size () == 1000);
+    CHECK (map.begin ()->first.get_allocator () == map.get_allocator ());
+}
+
+/**
+ * Random inserts, erases and lookups with incremental rehash agree with std::map, and copies and
+ * moves through the base HashMap keep the contents whatever arena they end up in
+ */
+static void testAgainstMap ()
+{
+    CachedArenaMap map;
+    map.setIncrementalRehash (true);
+    std::map<std::string , int> reference;
+    std::mt19937 random (2);
+    bool same = true;
+    for (int step = 0 ; step < 100000 ; ++ step)
+    {
+        std::string key = "key number " + std::to_string (random () % 20000) + " with padding";
+        int operation = (int) (random () % 3);
+        if (operation == 0)
+        {
+            map[std::pmr::string (key)] = step;
+            reference[key] = step;
+        }
+        else if (operation == 1)
+        {
+            same = same && map.erase (std::string_view (key)) == (reference.erase (key) == 1);
+        }
+        else
+        {
+            same = same && (map.find (std::string_view (key)) != map.end ()) ==
+                           (reference.count (key) == 1);
+        }
+    }
+    CHECK (same);
+    CHECK (map.size () == (int) reference.size ());
+    CachedArenaBase copy (map);
+    CHECK (copy == map);
+    CachedArenaMap other;
+    static_cast<CachedArenaBase &> (other) = map;
+    CHECK (static_cast<CachedArenaBase &> (other) == copy);
+    std::pmr::monotonic_buffer_resource elsewhere;
+    CachedArenaBase moved (std::move (copy) ,
+                           std::pmr::polymorphic_allocator<std::pair<std::pmr::string , int>> (
+                                   &elsewhere));
+    CHECK (moved == map);
+    CHECK (moved.begin ()->first.get_allocator ().resource () == &elsewhere);
+}
+
+/**
+ * Move only values, and a bulk insert that asks for threads stays on one
+ */
+static void testMoveOnlyBulk ()
+{
+    ArenaHashMap<std::pmr::string , std::unique_ptr<int>> map;
+    map.try_emplace ("a" , new int (3));
+    std::vector<std::pair<std::pmr::string , std::unique_ptr<int>>> pairs;
+    for (int i = 0 ; i < 2 * PARALLEL_BUILD ; ++ i)
+    {
+        pairs.emplace_back (std::to_string (i) , std::make_unique<int> (i));
+    }
+    map.bulk_insert (std::make_move_iterator (pairs.begin ()) ,
+                     std::make_move_iterator (pairs.end ()) , 4);
+    CHECK (map.size () == 2 * PARALLEL_BUILD + 1);
+    CHECK (*map.at ("a") == 3);
+    std::string last = std::to_string (2 * PARALLEL_BUILD - 1);
+    CHECK (*map.at (std::string_view (last)) == 2 * PARALLEL_BUILD - 1);
+}
+
+int main ()
+{
+    testBuildAllocatesBlocks ();
+    testAgainstMap ();
+    testMoveOnlyBulk ();
+    return testResult ();
+}
@@ -0,0 +1,79 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <random>
+#include "../BloomFilter.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * Amount of keys inserted in every filter
+ */
+static const size_t KEYS = 200000;
+
+/**
+ * Amount of missing keys checked against every filter
+ */
+static const size_t PROBES = 2000000;
+
+/**
+ * Every inserted key is let through, and about the asked rate of the missing ones
+ */
+static void testRates ()
+{
+    for (double rate : {0.1 , 0.01 , 0.001 , 0.0001})
+    {
+        BloomFilter filter (KEYS , rate);
+        std::mt19937_64 inserted (1);
+        for (size_t i = 0 ; i < KEYS ; ++ i)
+        {
+            filter.insert ((size_t) inserted ());
+        }
+        std::mt19937_64 again (1);
+        size_t falseNegatives = 0;
+        for (size_t i = 0 ; i < KEYS ; ++ i)
+        {
+            falseNegatives += ! filter.mayContain ((size_t) again ());
+        }
+        CHECK (falseNegatives == 0);
+        std::mt19937_64 missing (2);
+        size_t falsePositives = 0;
+        for (size_t i = 0 ; i < PROBES ; ++ i)
+        {
+            falsePositives += filter.mayContain ((size_t) missing ());
+        }
+        double observed = (double) falsePositives / PROBES;
+        CHECK (observed <= rate * 1.2);
+        CHECK (observed >= rate / 4);
+        CHECK (filter.hashes () >= 1 && filter.hashes () <= BLOOM_MAX_HASHES);
+        CHECK (filter.bits () % BLOOM_BLOCK_BITS == 0);
+    }
+}
+
+/**
+ * An empty filter lets every key through, and sequential hashes spread like random ones
+ */
+static void testEdges ()
+{
+    BloomFilter empty;
+    CHECK (empty.empty () && empty.mayContain (42));
+    BloomFilter none (0 , 0.01);
+    CHECK (! none.empty () && ! none.mayContain (42));
+    BloomFilter sequential (KEYS , 0.01);
+    for (size_t i = 0 ; i < KEYS ; ++ i)
+    {
+        sequential.insert (i);
+    }
+    size_t falsePositives = 0;
+    for (size_t i = KEYS ; i < KEYS + PROBES ; ++ i)
+    {
+        falsePositives += sequential.mayContain (i);
+    }
+    CHECK ((double) falsePositives / PROBES <= 0.012);
+}
+
+int main ()
+{
+    testRates ();
+    testEdges ();
+    return testResult ();
+}
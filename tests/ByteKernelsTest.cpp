@@ -0,0 +1,166 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <algorithm>
+#include <random>
+#include <string>
+#include "../AhoCorasick.hpp"
+#include "../ByteKernels.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * First position of a byte of the first set followed by a byte of the second, one byte at a time
+ * @param text Text to scan
+ * @param first Members of the first set
+ * @param second Members of the second set, nullptr to accept any
+ * @return Index of the first byte, the length if none
+ */
+static size_t naiveFind (const std::string & text , const bool *first , const bool *second)
+{
+    for (size_t i = 0 ; i < text.size () ; ++ i)
+    {
+        if (first[(unsigned char) text[i]] && (second == nullptr || i + 1 == text.size () ||
+                                               second[(unsigned char) text[i + 1]]))
+        {
+            return i;
+        }
+    }
+    return text.size ();
+}
+
+/**
+ * Every level lowers and finds like the naive loops, on random texts and sets of every size
+ */
+static void testKernels ()
+{
+    std::mt19937 random (9);
+    bool same = true;
+    for (int round = 0 ; round < 3000 ; ++ round)
+    {
+        std::string text (random () % 300 , '\0');
+        int alphabet = 1 + (int) (random () % BYTE_VALUES);
+        for (auto & c : text)
+        {
+            c = (char) (random () % alphabet + (random () % 2 ? 0 : 64));
+        }
+        bool first[BYTE_VALUES] = {};
+        bool second[BYTE_VALUES] = {};
+        int most = round % 3 == 0 ? 6 : 60;
+        for (int i = 1 + (int) (random () % most) ; i > 0 ; -- i)
+        {
+            first[random () % BYTE_VALUES] = true;
+        }
+        for (int i = 1 + (int) (random () % most) ; i > 0 ; -- i)
+        {
+            second[random () % BYTE_VALUES] = true;
+        }
+        ByteSet firstSet = ByteKernels::makeSet (first);
+        ByteSet secondSet = ByteKernels::makeSet (second);
+        std::string lowered = text;
+        std::transform (lowered.begin () , lowered.end () , lowered.begin () , [] (char c)
+        { return (c >= 'A' && c <= 'Z') ? (char) (c - 'A' + 'a') : c; });
+        for (int level = KERNEL_SCALAR ; level <= ByteKernels::supported () ; ++ level)
+        {
+            ByteKernels::setLevel (level);
+            for (size_t offset : {(size_t) 0 , text.size () / 3})
+            {
+                std::string tail = text.substr (offset);
+                same = same && ByteKernels::findAny (tail.data () , tail.size () , firstSet) ==
+                               naiveFind (tail , first , nullptr);
+                same = same && ByteKernels::findPair (tail.data () , tail.size () , firstSet ,
+                                                      &secondSet) == naiveFind (tail , first , second);
+            }
+            std::string copy = text;
+            ByteKernels::lowerAll (&copy[0] , copy.size ());
+            same = same && copy == lowered;
+        }
+    }
+    ByteKernels::setLevel (ByteKernels::supported ());
+    CHECK (same);
+    CHECK (ByteKernels::level () == ByteKernels::supported ());
+}
+
+/**
+ * The root prefilter of the automaton scores like a naive search at every level, whole, in
+ * chunks and when the scan stops at a threshold
+ */
+static void testPrefilter ()
+{
+    std::mt19937 random (11);
+    bool same = true;
+    for (int round = 0 ; round < 1500 ; ++ round)
+    {
+        PatternTable table;
+        std::string alphabet = round % 2 ? "abcxyz" : "qz";
+        for (int i = 1 + (int) (random () % 6) ; i > 0 ; -- i)
+        {
+            std::string key;
+            int length = 1 + (int) (random () % 4);
+            if (round % 3 == 0 && length == 1)
+            {
+                length = 2;
+            }
+            for (int j = 0 ; j < length ; ++ j)
+            {
+                key += alphabet[random () % alphabet.size ()];
+            }
+            table.insert (key , 1 + (int) (random () % 5));
+        }
+        AhoCorasick matcher (table);
+        std::string text;
+        for (int i = (int) (random () % 3000) ; i > 0 ; -- i)
+        {
+            int kind = (int) (random () % 10);
+            char c = alphabet[random () % alphabet.size ()];
+            text += kind < 2 ? (char) (c - 'a' + 'A') : kind < 4 ? c : (char) (random () % 256);
+        }
+        std::string lowered = text;
+        ByteKernels::setLevel (KERNEL_SCALAR);
+        ByteKernels::lowerAll (&lowered[0] , lowered.size ());
+        int naive = 0;
+        for (const auto & pair : table)
+        {
+            std::string key (pair.first);
+            for (size_t at = lowered.find (key) ; at != std::string::npos ;
+                 at = lowered.find (key , at + 1))
+            {
+                naive += pair.second;
+            }
+        }
+        for (int level = KERNEL_SCALAR ; level <= ByteKernels::supported () ; ++ level)
+        {
+            ByteKernels::setLevel (level);
+            same = same && matcher.score (text) == naive;
+            AhoCorasick::Scanner chunked (matcher);
+            for (size_t i = 0 ; i < text.size () ; )
+            {
+                size_t chunk = std::min ((size_t) (1 + random () % 100) , text.size () - i);
+                chunked.feed (text.data () + i , chunk);
+                i += chunk;
+            }
+            same = same && chunked.score () == naive;
+            int limit = 1 + (int) (random () % 20);
+            AhoCorasick::Scanner limited (matcher , limit);
+            size_t used = limited.feed (text.data () , text.size ());
+            if (naive >= limit)
+            {
+                AhoCorasick::Scanner prefix (matcher);
+                prefix.feed (text.data () , used - 1);
+                same = same && limited.reached () && prefix.score () < limit;
+            }
+            else
+            {
+                same = same && used == text.size ();
+            }
+        }
+    }
+    ByteKernels::setLevel (ByteKernels::supported ());
+    CHECK (same);
+}
+
+int main ()
+{
+    testKernels ();
+    testPrefilter ();
+    return testResult ();
+}
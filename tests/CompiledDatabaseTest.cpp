@@ -0,0 +1,113 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "../CompiledDatabase.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * Path of the database written by the tests
+ */
+static const char *const PATH = "compiled_database_test.db";
+
+/**
+ * FNV-1a over 64 bit words, as the checksum of the compiled database
+ * @param data Bytes to hash
+ * @return Checksum of the bytes
+ */
+static uint64_t checksum (const std::string & data)
+{
+    uint64_t hash = CHECKSUM_OFFSET;
+    size_t i = 0;
+    for ( ; i + sizeof (uint64_t) <= data.size () ; i += sizeof (uint64_t))
+    {
+        uint64_t word;
+        std::memcpy (&word , data.data () + i , sizeof (word));
+        hash = (hash ^ word) * CHECKSUM_PRIME;
+    }
+    for ( ; i < data.size () ; ++ i)
+    {
+        hash = (hash ^ (unsigned char) data[i]) * CHECKSUM_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * Reads a whole file
+ * @param path Path of the file
+ * @return Bytes of the file
+ */
+static std::string readAll (const std::string & path)
+{
+    std::ifstream in (path , std::ios::binary);
+    return std::string (std::istreambuf_iterator<char> (in) , std::istreambuf_iterator<char> ());
+}
+
+/**
+ * Writes a whole file
+ * @param path Path of the file
+ * @param bytes Bytes of the file
+ */
+static void writeAll (const std::string & path , const std::string & bytes)
+{
+    std::ofstream out (path , std::ios::binary | std::ios::trunc);
+    out.write (bytes.data () , (std::streamsize) bytes.size ());
+}
+
+/**
+ * A written database opens and gives back its table and matcher
+ */
+static void testRoundTrip ()
+{
+    PatternTable table;
+    table.insert ("free" , 3);
+    table.insert ("buy now" , 5);
+    AhoCorasick matcher (table);
+    CHECK (! CompiledDatabase::write (PATH , table , matcher));
+    CHECK (CompiledDatabase::isCompiled (PATH));
+    CompiledDatabase database;
+    CHECK (! database.open (PATH));
+    PatternTable loaded;
+    database.fill (loaded);
+    CHECK (loaded == table);
+    CHECK (database.matcher ().score ("Buy now, it is free!") == 8);
+}
+
+/**
+ * A header whose key bytes are so large that the sum of the section lengths wraps around to
+ * the size of the file, with a matching checksum and offsets, must be rejected
+ */
+static void testWrappingLength ()
+{
+    PatternTable table;
+    table.insert ("a" , 1);
+    AhoCorasick matcher (table);
+    CHECK (! CompiledDatabase::write (PATH , table , matcher));
+    std::string bytes = readAll (PATH);
+    // drop the key and one byte more, and claim 2^64 - 1 key bytes instead of 1
+    bytes.resize (bytes.size () - 2);
+    CompiledHeader head;
+    std::memcpy (&head , bytes.data () , sizeof (head));
+    head.keyBytes = UINT64_MAX;
+    uint64_t last = UINT64_MAX;
+    std::memcpy (&bytes[sizeof (head) + sizeof (uint64_t)] , &last , sizeof (last));
+    head.checksum = checksum (bytes.substr (sizeof (head)));
+    std::memcpy (&bytes[0] , &head , sizeof (head));
+    writeAll (PATH , bytes);
+    CompiledDatabase database;
+    CHECK (database.open (PATH));
+    writeAll (PATH , bytes.substr (0 , sizeof (head) - 1));
+    CHECK (database.open (PATH));
+}
+
+int main ()
+{
+    testRoundTrip ();
+    testWrappingLength ();
+    std::remove (PATH);
+    return testResult ();
+}
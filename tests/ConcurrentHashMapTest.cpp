@@ -0,0 +1,220 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "../ConcurrentHashMap.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * Amount of threads of the concurrent tests
+ */
+static const int THREADS = 4;
+
+/**
+ * Amount of keys every thread writes
+ */
+static const int KEYS_PER_THREAD = 20000;
+
+/**
+ * The mixing helper spreads a change of one bit over the whole hash
+ */
+static void testMixHash ()
+{
+    CHECK (mixHash (0) == 0);
+    CHECK (mixHash (1) != mixHash (2));
+    CHECK ((mixHash (1) >> 32) != 0);
+    CHECK (StringHash {} ("spam") == StringHash {} (std::string ("spam")));
+}
+
+/**
+ * Single threaded use, with string keys looked up by string_view
+ */
+static void testSingleThread ()
+{
+    ConcurrentHashMap<std::string , int , StringHash> map (5);
+    CHECK (map.shards () == 8);
+    CHECK (map.empty ());
+    CHECK (map.insert (std::string ("free") , 1));
+    CHECK (! map.insert (std::string ("free") , 2));
+    CHECK (map.try_emplace (std::string ("buy") , 3));
+    CHECK (! map.try_emplace (std::string ("buy") , 4));
+    int value = 0;
+    CHECK (map.find (std::string_view ("free") , value) && value == 2);
+    CHECK (! map.find (std::string_view ("now") , value));
+    int seen = 0;
+    CHECK (map.visit (std::string_view ("buy") , [&] (const int & found) { seen = found; }));
+    CHECK (seen == 3);
+    CHECK (map.containsKey (std::string_view ("buy")));
+    CHECK (map.erase (std::string_view ("buy")));
+    CHECK (! map.erase (std::string_view ("buy")));
+    CHECK (map.size () == 1);
+    map.clear ();
+    CHECK (map.empty ());
+    ConcurrentHashMap<int , int> single (1);
+    CHECK (single.insert (1 , 1) && single.containsKey (1));
+}
+
+/**
+ * Threads insert disjoint keys while others read and erase, every insert is kept and every read
+ * sees either nothing or the written value
+ */
+static void testConcurrent ()
+{
+    ConcurrentHashMap<int , int> map;
+    map.reserve (THREADS * KEYS_PER_THREAD);
+    std::atomic<int> wrongReads (0);
+    std::vector<std::thread> threads;
+    for (int t = 0 ; t < THREADS ; ++ t)
+    {
+        threads.emplace_back ([&map , t] ()
+                              {
+                                  for (int i = 0 ; i < KEYS_PER_THREAD ; ++ i)
+                                  {
+                                      int key = t * KEYS_PER_THREAD + i;
+                                      map.insert (key , key * 2);
+                                      map.insert (- key - 1 , 0);
+                                      map.erase (- key - 1);
+                                  }
+                              });
+        threads.emplace_back ([&map , &wrongReads] ()
+                              {
+                                  for (int i = 0 ; i < THREADS * KEYS_PER_THREAD ; ++ i)
+                                  {
+                                      int value = - 1;
+                                      if (map.find (i , value) && value != i * 2)
+                                      {
+                                          ++ wrongReads;
+                                      }
+                                  }
+                              });
+    }
+    for (auto & thread : threads)
+    {
+        thread.join ();
+    }
+    CHECK (wrongReads == 0);
+    CHECK (map.size () == THREADS * KEYS_PER_THREAD);
+    long long sum = 0;
+    map.forEach ([&sum] (const std::pair<int , int> & pair) { sum += pair.second - 2 * pair.first; });
+    CHECK (sum == 0);
+    int value = 0;
+    CHECK (map.find (THREADS * KEYS_PER_THREAD - 1 , value));
+    CHECK (value == 2 * (THREADS * KEYS_PER_THREAD - 1));
+    CHECK (! map.containsKey (- 1));
+}
+
+/**
+ * Lock free reads while writers grow the shards, assign and erase: a key that is never erased is
+ * always found, with either of the values written to it, and a visit may read another map
+ */
+static void testOptimisticReads ()
+{
+    const int stable = 1000;
+    ConcurrentHashMap<int , int> map (2);
+    ConcurrentHashMap<int , int> other;
+    for (int i = 0 ; i < stable ; ++ i)
+    {
+        map.insert (i , i);
+        other.insert (i , - i);
+    }
+    std::atomic<bool> writing (true);
+    std::atomic<int> wrongReads (0);
+    std::vector<std::thread> threads;
+    threads.emplace_back ([&map , &writing] ()
+                          {
+                              for (int i = stable ; i < 50000 ; ++ i)
+                              {
+                                  map.insert (i , i);
+                                  map.insert (i % stable , i % stable + (i & 1) * 1000000);
+                                  if (i >= stable + stable / 2)
+                                  {
+                                      map.erase (i - stable / 2);
+                                  }
+                              }
+                              writing = false;
+                          });
+    for (int t = 0 ; t < THREADS ; ++ t)
+    {
+        threads.emplace_back ([&map , &other , &writing , &wrongReads] ()
+                              {
+                                  for (int i = 0 ; writing || i < stable ; ++ i)
+                                  {
+                                      int key = i % stable;
+                                      int value = - 1;
+                                      bool found = map.visit (key , [&] (const int & seen)
+                                      {
+                                          value = seen;
+                                          other.find (key , value);
+                                      });
+                                      if (! found || value != - key)
+                                      {
+                                          ++ wrongReads;
+                                      }
+                                      if (! map.find (key , value) ||
+                                          (value != key && value != key + 1000000))
+                                      {
+                                          ++ wrongReads;
+                                      }
+                                  }
+                              });
+    }
+    for (auto & thread : threads)
+    {
+        thread.join ();
+    }
+    CHECK (wrongReads == 0);
+    CHECK (map.size () == stable + stable / 2);
+    CHECK (map.containsKey (49999) && ! map.containsKey (stable + 1));
+}
+
+/**
+ * Threads past the amount of epoch records read under the shard locks and still see every key
+ */
+static void testManyReaders ()
+{
+    ConcurrentHashMap<int , int> map;
+    for (int i = 0 ; i < 100 ; ++ i)
+    {
+        map.insert (i , i);
+    }
+    std::atomic<int> started (0);
+    std::atomic<int> wrongReads (0);
+    std::vector<std::thread> threads;
+    for (int t = 0 ; t < EPOCH_READERS + 8 ; ++ t)
+    {
+        threads.emplace_back ([&map , &started , &wrongReads] ()
+                              {
+                                  int value = - 1;
+                                  wrongReads += ! map.find (1 , value) || value != 1;
+                                  // every thread holds its record until all of them read once
+                                  ++ started;
+                                  while (started < EPOCH_READERS + 8)
+                                  {
+                                      std::this_thread::yield ();
+                                  }
+                                  for (int i = 0 ; i < 100 ; ++ i)
+                                  {
+                                      wrongReads += ! map.find (i , value) || value != i;
+                                  }
+                              });
+    }
+    for (auto & thread : threads)
+    {
+        thread.join ();
+    }
+    CHECK (wrongReads == 0);
+}
+
+int main ()
+{
+    testMixHash ();
+    testSingleThread ();
+    testConcurrent ();
+    testOptimisticReads ();
+    testManyReaders ();
+    return testResult ();
+}
@@ -0,0 +1,100 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../DatabaseParser.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * Parses a whole literal on one thread, the entries view into the literal
+ * @param data Buffer to parse
+ * @param entries Filled with the entries
+ * @return true if invalid false otherwise
+ */
+static bool parse (const char *data , std::vector<DatabaseParser::Entry> & entries)
+{
+    return DatabaseParser::parse (data , std::strlen (data) , entries);
+}
+
+/**
+ * Valid lines give their phrase and score, in file order
+ */
+static void testValid ()
+{
+    std::vector<DatabaseParser::Entry> entries;
+    CHECK (! parse ("buy now,12\nfree,00007\nmax,2147483647" , entries));
+    CHECK (entries.size () == 3);
+    CHECK (entries[0] == DatabaseParser::Entry ("buy now" , 12));
+    CHECK (entries[1] == DatabaseParser::Entry ("free" , 7));
+    CHECK (entries[2] == DatabaseParser::Entry ("max" , 2147483647));
+    CHECK (! parse ("a,1\n" , entries));
+    CHECK (entries.size () == 1 && entries[0].second == 1);
+    CHECK (! parse (" spaced phrase ,0" , entries));
+    CHECK (entries[0].first == " spaced phrase ");
+}
+
+/**
+ * A line without exactly one comma, with an empty phrase or score, with a score that is not
+ * digits or overflows an int, and an empty line are all invalid
+ */
+static void testInvalid ()
+{
+    const char *lines[] = {"a" , ",1" , "a," , "a,1,2" , "a,,1" , "a,1x" , "a,-1" , "a, 1" ,
+                           "a,2147483648" , "a,99999999999999999999" , "a,1\n\nb,2" , "\n" ,
+                           "a,1\n,"};
+    int rejected = 0;
+    for (const char *line : lines)
+    {
+        std::vector<DatabaseParser::Entry> entries;
+        rejected += parse (line , entries);
+    }
+    CHECK (rejected == sizeof (lines) / sizeof (lines[0]));
+    DatabaseParser::Entry entry;
+    CHECK (DatabaseParser::parseLine ("a,b" , entry));
+    CHECK (! DatabaseParser::parseLine ("a,5" , entry) && entry.second == 5);
+}
+
+/**
+ * Large buffers give the same entries on any amount of threads, with or without a last newline,
+ * and an invalid line in any chunk makes the whole buffer invalid
+ */
+static void testThreads ()
+{
+    std::string big;
+    for (int i = 0 ; i < 300000 ; ++ i)
+    {
+        big += "phrase" + std::to_string (i) + "," + std::to_string (i) + "\n";
+    }
+    CHECK (big.size () >= PARALLEL_PARSE);
+    for (bool lastNewline : {true , false})
+    {
+        std::string data = big;
+        if (! lastNewline)
+        {
+            data.pop_back ();
+        }
+        std::vector<DatabaseParser::Entry> single;
+        CHECK (! DatabaseParser::parse (data.data () , data.size () , single));
+        CHECK (single.size () == 300000 && single.back ().second == 299999);
+        for (unsigned int threads : {2u , 3u , 7u , 64u})
+        {
+            std::vector<DatabaseParser::Entry> parallel;
+            CHECK (! DatabaseParser::parse (data.data () , data.size () , parallel , threads));
+            CHECK (parallel == single);
+        }
+    }
+    std::string bad = big;
+    bad.insert (bad.size () / 2 , ",,");
+    std::vector<DatabaseParser::Entry> entries;
+    CHECK (DatabaseParser::parse (bad.data () , bad.size () , entries , 4));
+}
+
+int main ()
+{
+    testValid ();
+    testInvalid ();
+    testThreads ();
+    return testResult ();
+}
@@ -0,0 +1,216 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "../FlatHashMap.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * Hash that sends every key to the same slot
+ */
+struct ConstantHash
+{
+    size_t operator() (int key) const
+    {
+        (void) key;
+        return 7;
+    }
+};
+
+/**
+ * Random inserts, assigns and erases give the same contents as std::map, checked through
+ * lookups and through iteration
+ */
+static void testAgainstMap ()
+{
+    std::mt19937 random (3);
+    FlatHashMap<int , int> map;
+    std::map<int , int> reference;
+    bool same = true;
+    for (int i = 0 ; i < 300000 ; ++ i)
+    {
+        int key = (int) (random () % 20000);
+        int value = (int) (random () % 1000);
+        switch (random () % 5)
+        {
+            case 0:
+                same = same && map.insert (key , value) ==
+                               reference.insert_or_assign (key , value).second;
+                break;
+            case 1:
+                same = same && map.try_emplace (key , value).second ==
+                               reference.try_emplace (key , value).second;
+                break;
+            case 2:
+                map[key] += value;
+                reference[key] += value;
+                break;
+            default:
+                same = same && map.erase (key) == (reference.erase (key) == 1);
+                break;
+        }
+        if (i % 9973 == 0)
+        {
+            std::map<int , int> contents (map.begin () , map.end ());
+            same = same && contents == reference && map.size () == (int) reference.size ();
+        }
+    }
+    CHECK (same);
+    for (const auto & pair : reference)
+    {
+        same = same && map.containsKey (pair.first) && map.at (pair.first) == pair.second;
+    }
+    CHECK (same);
+    CHECK (! map.containsKey (- 1) && map.find (- 1) == map.end ());
+    CHECK (map.getLoadFactor () <= FLAT_UPPER_BOUND);
+}
+
+/**
+ * The HashMap interface: single probe inserts, lookups by string_view, copies, moves and swaps
+ */
+static void testInterface ()
+{
+    FlatHashMap<std::string , int , StringHash> map {{"free" , 1} , {"buy" , 2} , {"free" , 3}};
+    CHECK (map.size () == 2 && map.at ("free") == 3);
+    CHECK (! map.try_emplace ("buy" , 5).second && map.at ("buy") == 2);
+    auto assigned = map.insert_or_assign ("buy" , 6);
+    CHECK (! assigned.second && assigned.first->second == 6);
+    CHECK (map.insert_or_assign ("now" , 7).second);
+    CHECK (! map.emplace ("now" , 8).second && map.at ("now") == 7);
+    CHECK (map.find (std::string_view ("now"))->second == 7);
+    CHECK (map.find (std::string_view ("never")) == map.end ());
+    bool thrown = false;
+    try
+    {
+        map.at ("never");
+    }
+    catch (const indexException &)
+    {
+        thrown = true;
+    }
+    CHECK (thrown);
+    const FlatHashMap<std::string , int , StringHash> & constant = map;
+    CHECK (constant["never"] == 0 && ! map.containsKey ("never"));
+    FlatHashMap<std::string , int , StringHash> copy (map);
+    copy.erase ("free");
+    CHECK (map.containsKey ("free") && ! copy.containsKey ("free") && copy != map);
+    FlatHashMap<std::string , int , StringHash> moved (std::move (copy));
+    CHECK (moved.size () == 2 && copy.empty () && copy.begin () == copy.end ());
+    CHECK (! copy.containsKey ("buy") && copy.insert ("buy" , 1) && copy.at ("buy") == 1);
+    swap (moved , copy);
+    CHECK (moved.size () == 1 && copy.size () == 2);
+    copy = map;
+    CHECK (copy == map);
+    thrown = false;
+    try
+    {
+        FlatHashMap<int , int> wrong (std::vector<int> {1 , 2} , std::vector<int> {1});
+    }
+    catch (const sizeException &)
+    {
+        thrown = true;
+    }
+    CHECK (thrown);
+}
+
+/**
+ * Keys with clustered hashes spread over the slots, and a hash that sends every key to one slot
+ * is slow but keeps the map at the capacity its size needs
+ */
+static void testBadHashes ()
+{
+    FlatHashMap<int , int> clustered;
+    for (int i = 0 ; i < 10000 ; ++ i)
+    {
+        clustered.insert (i << 16 , i);
+    }
+    CHECK (clustered.size () == 10000 && clustered.capacity () == 16384);
+    CHECK (clustered.at (9999 << 16) == 9999);
+    FlatHashMap<int , int , ConstantHash> constant;
+    for (int i = 0 ; i < 2000 ; ++ i)
+    {
+        constant.insert (i , i);
+    }
+    CHECK (constant.size () == 2000 && constant.capacity () == 4096);
+    bool found = true;
+    for (int i = 0 ; i < 2000 ; i += 7)
+    {
+        found = found && constant.at (i) == i;
+        constant.erase (i);
+    }
+    for (int i = 0 ; i < 2000 ; ++ i)
+    {
+        found = found && constant.containsKey (i) == (i % 7 != 0);
+    }
+    CHECK (found);
+}
+
+/**
+ * Presizing, shrinking with hysteresis and the load factor policy
+ */
+static void testCapacity ()
+{
+    FlatHashMap<int , int> map;
+    map.reserve (1000);
+    int reserved = map.capacity ();
+    for (int i = 0 ; i < 1000 ; ++ i)
+    {
+        map.insert (i , i);
+    }
+    CHECK (reserved == 2048 && map.capacity () == reserved);
+    // a quarter of 2048 is 512, erasing down to it does not shrink yet
+    for (int i = 0 ; i < 488 ; ++ i)
+    {
+        map.erase (i);
+    }
+    CHECK (map.size () == 512 && map.capacity () == 2048);
+    map.erase (488);
+    CHECK (map.capacity () == 1024);
+    map.shrink_to_fit ();
+    CHECK (map.capacity () == 1024 && map.size () == 511);
+    map.setAutoShrink (false);
+    for (int i = 489 ; i < 990 ; ++ i)
+    {
+        map.erase (i);
+    }
+    CHECK (map.capacity () == 1024);
+    map.shrink_to_fit ();
+    CHECK (map.capacity () == 16 && map.size () == 10 && map.at (995) == 995);
+    bool thrown = false;
+    try
+    {
+        map.setLoadFactors (0.5 , 0.9);
+    }
+    catch (const sizeException &)
+    {
+        thrown = true;
+    }
+    CHECK (thrown);
+    thrown = false;
+    try
+    {
+        map.setLoadFactors (0.1 , 1.5);
+    }
+    catch (const sizeException &)
+    {
+        thrown = true;
+    }
+    CHECK (thrown);
+    map.setLoadFactors (0 , 1);
+    map.reserve (16);
+    CHECK (map.capacity () == 16);
+}
+
+int main ()
+{
+    testAgainstMap ();
+    testInterface ();
+    testBadHashes ();
+    testCapacity ();
+    return testResult ();
+}
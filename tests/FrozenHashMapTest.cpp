@@ -0,0 +1,84 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <string>
+#include <vector>
+#include "../FrozenHashMap.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * Hash of strings by their length only, so distinct keys of the same length collide
+ */
+struct LengthHash
+{
+    size_t operator() (const std::string & key) const
+    {
+        return key.size ();
+    }
+};
+
+/**
+ * Builds over many keys and finds every one of them, and none of the missing ones
+ */
+static void testLookup ()
+{
+    std::vector<std::pair<int , int>> pairs;
+    for (int i = 0 ; i < 100000 ; ++ i)
+    {
+        pairs.emplace_back (i * 7 , i);
+    }
+    FrozenHashMap<int , int> map (pairs.begin () , pairs.end ());
+    CHECK (map.size () == 100000);
+    bool found = true;
+    for (int i = 0 ; i < 100000 ; ++ i)
+    {
+        found = found && map.containsKey (i * 7) && map.at (i * 7) == i;
+    }
+    CHECK (found);
+    CHECK (! map.containsKey (1));
+    CHECK (! map.containsKey (- 7));
+}
+
+/**
+ * A repeated key keeps its last value
+ */
+static void testDuplicates ()
+{
+    FrozenHashMap<std::string , int> map {{"a" , 1} , {"b" , 2} , {"a" , 3}};
+    CHECK (map.size () == 2);
+    CHECK (map.at ("a") == 3);
+    CHECK (map.at ("b") == 2);
+    FrozenHashMap<std::string , int> empty;
+    CHECK (empty.empty ());
+    CHECK (! empty.containsKey ("a"));
+}
+
+/**
+ * Distinct keys with the same hash can not be placed by any seed, the build must fail rather
+ * than retry forever, while a repeated key with a colliding hash is still deduplicated
+ */
+static void testCollidingHashes ()
+{
+    bool thrown = false;
+    try
+    {
+        FrozenHashMap<std::string , int , LengthHash> map {{"ab" , 1} , {"cd" , 2}};
+    }
+    catch (const buildException &)
+    {
+        thrown = true;
+    }
+    CHECK (thrown);
+    FrozenHashMap<std::string , int , LengthHash> same {{"ab" , 1} , {"ab" , 2} , {"abc" , 3}};
+    CHECK (same.size () == 2);
+    CHECK (same.at ("ab") == 2);
+    CHECK (! same.containsKey ("cd"));
+}
+
+int main ()
+{
+    testLookup ();
+    testDuplicates ();
+    testCollidingHashes ();
+    return testResult ();
+}
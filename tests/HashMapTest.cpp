@@ -0,0 +1,368 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../HashMap.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * A moved from map has no buckets, copying it must give a usable empty map
+ */
+static void testCopyMovedFrom ()
+{
+    HashMap<std::string , int> source {{"a" , 1} , {"b" , 2}};
+    HashMap<std::string , int> target (std::move (source));
+    CHECK (target.size () == 2);
+    HashMap<std::string , int> copy (source);
+    CHECK (copy.empty ());
+    CHECK (copy.find ("a") == copy.end ());
+    CHECK (! copy.containsKey ("a"));
+    CHECK (copy.insert ("a" , 3));
+    CHECK (copy.at ("a") == 3);
+    HashMap<std::string , int> assigned {{"c" , 4}};
+    assigned = source;
+    CHECK (assigned.empty ());
+    CHECK (! assigned.containsKey ("c"));
+    assigned["d"] = 5;
+    CHECK (assigned.size () == 1 && assigned.at ("d") == 5);
+    CHECK (source.insert ("e" , 6));
+    CHECK (source.at ("e") == 6);
+}
+
+/**
+ * Copies are deep and moves and swaps exchange the contents
+ */
+static void testCopyMoveSwap ()
+{
+    HashMap<int , int> first;
+    for (int i = 0 ; i < 1000 ; ++ i)
+    {
+        first.insert (i , i * 2);
+    }
+    HashMap<int , int> copy (first);
+    copy.erase (0);
+    CHECK (first.containsKey (0) && ! copy.containsKey (0));
+    HashMap<int , int> second {{- 1 , - 1}};
+    second.swap (first);
+    CHECK (second.size () == 1000 && first.size () == 1);
+    CHECK (second.at (999) == 1998 && first.at (- 1) == - 1);
+    first = std::move (second);
+    CHECK (first.size () == 1000 && second.empty ());
+    CHECK (first == HashMap<int , int> (first));
+}
+
+/**
+ * Hash that throws for one key
+ */
+struct ThrowingHash
+{
+    size_t operator() (int key) const
+    {
+        if (key == 12345)
+        {
+            throw std::runtime_error ("hash");
+        }
+        return std::hash<int> {} (key);
+    }
+};
+
+/**
+ * A hash that throws during a parallel bulk insert must leave the map as it was, with no pair
+ * stored under a hash that was never computed
+ */
+static void testBulkInsertThrows ()
+{
+    std::vector<std::pair<int , int>> pairs;
+    for (int i = 0 ; i < 2 * PARALLEL_BUILD ; ++ i)
+    {
+        pairs.emplace_back (i , i);
+    }
+    HashMap<int , int , ThrowingHash> map;
+    map.insert (- 1 , - 1);
+    bool thrown = false;
+    try
+    {
+        map.bulk_insert (pairs.begin () , pairs.end () , 4);
+    }
+    catch (const std::runtime_error &)
+    {
+        thrown = true;
+    }
+    CHECK (thrown);
+    CHECK (map.size () == 1);
+    CHECK (map.at (- 1) == - 1);
+    CHECK (! map.containsKey (0));
+    int seen = 0;
+    for (const auto & pair : map)
+    {
+        seen += pair.first == - 1 ? 1 : 100;
+    }
+    CHECK (seen == 1);
+    HashMap<int , int> plain;
+    plain.bulk_insert (pairs.begin () , pairs.end () , 4);
+    CHECK (plain.size () == 2 * PARALLEL_BUILD);
+    CHECK (plain.at (12345) == 12345);
+}
+
+/**
+ * Iterating visits every pair once, through random inserts and erases with and without
+ * incremental rehash, after a parallel bulk insert and when only a few pairs are left in many
+ * buckets; dereferencing gives the stored pair itself
+ */
+static void testIteration ()
+{
+    auto contents = [] (const HashMap<int , int> & map)
+    {
+        std::multiset<int> keys;
+        for (const auto & pair : map)
+        {
+            keys.insert (pair.second == pair.first * 2 ? pair.first : - 1);
+        }
+        return keys;
+    };
+    std::mt19937 random (5);
+    for (bool incremental : {false , true})
+    {
+        HashMap<int , int> map;
+        map.setIncrementalRehash (incremental);
+        std::set<int> reference;
+        bool same = true;
+        for (int i = 0 ; i < 200000 ; ++ i)
+        {
+            int key = (int) (random () % 50000);
+            if (random () % 3)
+            {
+                map.insert (key , key * 2);
+                reference.insert (key);
+            }
+            else
+            {
+                map.erase (key);
+                reference.erase (key);
+            }
+            if (i % 9973 == 0)
+            {
+                std::multiset<int> keys = contents (map);
+                same = same && std::set<int> (keys.begin () , keys.end ()) == reference &&
+                       keys.size () == reference.size ();
+            }
+        }
+        CHECK (same);
+        std::multiset<int> keys = contents (HashMap<int , int> (map));
+        CHECK (std::set<int> (keys.begin () , keys.end ()) == reference);
+        const auto & first = *map.begin ();
+        CHECK (&first == &*map.find (first.first));
+        map.clear ();
+        CHECK (map.begin () == map.end ());
+    }
+    std::vector<std::pair<int , int>> pairs;
+    for (int i = 0 ; i < 2 * PARALLEL_BUILD ; ++ i)
+    {
+        pairs.emplace_back (i , i * 2);
+    }
+    HashMap<int , int> bulk;
+    bulk.bulk_insert (pairs.begin () , pairs.end () , 4);
+    CHECK (contents (bulk).size () == 2 * PARALLEL_BUILD);
+    CHECK (* contents (bulk).begin () == 0);
+    HashMap<int , int> sparse;
+    sparse.setAutoShrink (false);
+    for (int i = 0 ; i < 100000 ; ++ i)
+    {
+        sparse.insert (i , i * 2);
+    }
+    for (int i = 10 ; i < 100000 ; ++ i)
+    {
+        sparse.erase (i);
+    }
+    CHECK (contents (sparse) == std::multiset<int> ({0 , 1 , 2 , 3 , 4 , 5 , 6 , 7 , 8 , 9}));
+}
+
+/**
+ * The single probe API: try_emplace and emplace never overwrite, insert_or_assign tells an
+ * insert from an assign, and a missing key is an end () iterator or a default value, never an
+ * exception; random operations keep the map equal to std::map
+ */
+static void testSingleProbe ()
+{
+    HashMap<std::string , int> map;
+    auto inserted = map.try_emplace ("free" , 1);
+    CHECK (inserted.second && inserted.first->first == "free" && inserted.first->second == 1);
+    auto kept = map.try_emplace ("free" , 2);
+    CHECK (! kept.second && kept.first->second == 1 && map.at ("free") == 1);
+    CHECK (kept.first == inserted.first);
+    auto fresh = map.insert_or_assign ("buy" , 3);
+    CHECK (fresh.second && fresh.first->second == 3);
+    auto assigned = map.insert_or_assign ("buy" , 4);
+    CHECK (! assigned.second && assigned.first->second == 4 && map.at ("buy") == 4);
+    auto emplaced = map.emplace ("buy" , 5);
+    CHECK (! emplaced.second && emplaced.first->second == 4);
+    CHECK (map.emplace (std::string ("now") , 6).second && map.at ("now") == 6);
+    CHECK (map.find ("never") == map.end ());
+    CHECK (map.find ("free") != map.end () && map.find ("free")->second == 1);
+    CHECK (map.size () == 3);
+    bool thrown = false;
+    try
+    {
+        map["later"] += 7;
+        const HashMap<std::string , int> & constant = map;
+        thrown = constant["never"] != 0;
+    }
+    catch (...)
+    {
+        thrown = true;
+    }
+    CHECK (! thrown && map.at ("later") == 7 && ! map.containsKey ("never"));
+    // pairs change only through the map, never through its iterators
+    static_assert (std::is_same<decltype (*map.begin ()) ,
+                                const std::pair<std::string , int> &>::value , "mutable pair");
+    static_assert (std::is_same<decltype (map.begin ().operator-> ()) ,
+                                const std::pair<std::string , int> *>::value , "mutable pair");
+    map.at ("later") = 10;
+    CHECK (static_cast<const HashMap<std::string , int> &> (map).at ("later") == 10);
+    std::string moved = "moved";
+    CHECK (! map.try_emplace (std::string ("free") , 8).second);
+    CHECK (map.try_emplace (std::move (moved) , 9).second && map.at ("moved") == 9);
+    std::mt19937 random (9);
+    HashMap<int , int> numbers;
+    std::map<int , int> reference;
+    bool same = true;
+    for (int i = 0 ; i < 200000 ; ++ i)
+    {
+        int key = (int) (random () % 5000);
+        int value = (int) (random () % 1000);
+        switch (random () % 6)
+        {
+            case 0:
+                same = same && numbers.try_emplace (key , value).second ==
+                               reference.try_emplace (key , value).second;
+                break;
+            case 1:
+                same = same && numbers.insert_or_assign (key , value).second ==
+                               reference.insert_or_assign (key , value).second;
+                break;
+            case 2:
+                same = same && numbers.emplace (key , value).second ==
+                               reference.emplace (key , value).second;
+                break;
+            case 3:
+                numbers[key] += value;
+                reference[key] += value;
+                break;
+            case 4:
+            {
+                auto found = numbers.find (key);
+                auto expected = reference.find (key);
+                same = same && (found == numbers.end () ? expected == reference.end () :
+                                expected != reference.end () && found->second == expected->second);
+                break;
+            }
+            default:
+                same = same && numbers.erase (key) == (reference.erase (key) == 1);
+                break;
+        }
+    }
+    CHECK (same && numbers.size () == (int) reference.size ());
+    for (const auto & pair : reference)
+    {
+        same = same && numbers.at (pair.first) == pair.second;
+    }
+    CHECK (same);
+}
+
+/**
+ * reserve presizes so the inserts never resize, erase shrinks only past the lower load factor
+ * and the shrunk map then takes inserts and erases around that point without resizing again,
+ * rehash and shrink_to_fit pick the smallest fitting capacity, and an invalid pair of load
+ * factors is rejected
+ */
+static void testCapacity ()
+{
+    for (bool incremental : {false , true})
+    {
+        HashMap<int , int> map;
+        map.setIncrementalRehash (incremental);
+        map.reserve (1000);
+        CHECK (map.capacity () == 2048 && ! map.rehashing ());
+        bool resized = false;
+        for (int i = 0 ; i < 1000 ; ++ i)
+        {
+            map.insert (i , i);
+            resized = resized || map.capacity () != 2048 || map.rehashing ();
+        }
+        CHECK (! resized);
+        // a quarter of 2048 is 512, the map shrinks only once it holds less
+        for (int i = 0 ; i < 488 ; ++ i)
+        {
+            map.erase (i);
+        }
+        CHECK (map.size () == 512 && map.capacity () == 2048);
+        map.erase (488);
+        CHECK (map.size () == 511 && map.capacity () == 1024);
+        for (int i = 0 ; i < 100 ; ++ i)
+        {
+            map.insert (i , i);
+            map.insert (- i - 1 , i);
+            map.erase (i);
+            map.erase (- i - 1);
+            resized = resized || map.capacity () != 1024;
+        }
+        CHECK (! resized && map.size () == 511);
+        map.setIncrementalRehash (false);
+    }
+    HashMap<int , int> map;
+    for (int i = 0 ; i < 1000 ; ++ i)
+    {
+        map.insert (i , i);
+    }
+    map.rehash (5000);
+    CHECK (map.capacity () == 8192 && map.at (999) == 999);
+    map.rehash (10);
+    CHECK (map.capacity () == 2048);
+    map.setAutoShrink (false);
+    for (int i = 10 ; i < 1000 ; ++ i)
+    {
+        map.erase (i);
+    }
+    CHECK (map.size () == 10 && map.capacity () == 2048);
+    map.shrink_to_fit ();
+    CHECK (map.capacity () == 16 && map.at (9) == 9);
+    map.setAutoShrink (true);
+    map.setLoadFactors (0.1 , 0.5);
+    CHECK (map.getMinLoadFactor () == 0.1 && map.getMaxLoadFactor () == 0.5);
+    map.shrink_to_fit ();
+    CHECK (map.capacity () == 32);
+    const std::pair<double , double> invalid[] = {{0.5 , 0.9} , {0.3 , 0.6} , {- 0.1 , 0.75} ,
+                                                  {0.1 , 0}};
+    int rejected = 0;
+    for (const auto & factors : invalid)
+    {
+        try
+        {
+            map.setLoadFactors (factors.first , factors.second);
+        }
+        catch (const sizeException &)
+        {
+            ++ rejected;
+        }
+    }
+    CHECK (rejected == 4);
+    CHECK (map.getMinLoadFactor () == 0.1 && map.getMaxLoadFactor () == 0.5);
+}
+
+int main ()
+{
+    testCopyMovedFrom ();
+    testCopyMoveSwap ();
+    testBulkInsertThrows ();
+    testIteration ();
+    testSingleProbe ();
+    testCapacity ();
+    return testResult ();
+}
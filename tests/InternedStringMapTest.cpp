@@ -0,0 +1,138 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <map>
+#include <random>
+#include <string>
+#include "../InternedStringMap.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * Random inserts, erases, lookups, clears and reserves give the same contents as std::map,
+ * and erasing often enough compacts the arena
+ */
+static void testAgainstMap ()
+{
+    std::mt19937 random (7);
+    for (int round = 0 ; round < 20 ; ++ round)
+    {
+        InternedStringMap<int> map;
+        std::map<std::string , int> reference;
+        int keys = 1 + (int) (random () % 3000);
+        bool same = true;
+        for (int step = 0 ; step < 20000 ; ++ step)
+        {
+            std::string key = "k" + std::to_string (random () % keys) +
+                              std::string (random () % 3 ? 0 : random () % 40 , 'x');
+            int operation = (int) (random () % 10);
+            if (operation < 4)
+            {
+                int value = (int) random ();
+                same = same && map.insert (key , value) == (reference.count (key) == 0);
+                reference[key] = value;
+            }
+            else if (operation < 6)
+            {
+                same = same && map.erase (key) == (reference.erase (key) > 0);
+            }
+            else if (operation < 7)
+            {
+                auto placed = map.try_emplace (key , 5);
+                same = same && placed.second == (reference.count (key) == 0);
+                reference.emplace (key , 5);
+                same = same && placed.first->first == key && placed.first->second == reference[key];
+            }
+            else if (operation < 8)
+            {
+                map[key] += 1;
+                reference[key] += 1;
+            }
+            else if (operation < 9)
+            {
+                same = same && map.containsKey (key) == (reference.count (key) > 0);
+                same = same && (reference.count (key) == 0 || map.at (key) == reference[key]);
+            }
+            else if (random () % 500 == 0)
+            {
+                map.clear ();
+                reference.clear ();
+            }
+            else if (random () % 300 == 0)
+            {
+                map.reserve ((int) (random () % 5000));
+            }
+            same = same && map.size () == (int) reference.size ();
+        }
+        CHECK (same);
+        std::map<std::string , int> contents;
+        for (const auto & pair : map)
+        {
+            contents.emplace (std::string (pair.first) , pair.second);
+        }
+        CHECK (contents == reference);
+        InternedStringMap<int> copy (reference.begin () , reference.end ());
+        CHECK (copy == map);
+        const InternedStringMap<int> & constant = map;
+        for (const auto & pair : reference)
+        {
+            same = same && constant[pair.first] == pair.second;
+        }
+        CHECK (same);
+    }
+}
+
+/**
+ * Missing keys throw from at and read as a default value from the const operator[]
+ */
+static void testMissing ()
+{
+    InternedStringMap<int> map;
+    bool thrown = false;
+    try
+    {
+        map.at ("x");
+    }
+    catch (const indexException &)
+    {
+        thrown = true;
+    }
+    CHECK (thrown);
+    const InternedStringMap<int> & constant = map;
+    CHECK (constant["x"] == 0);
+    CHECK (map.empty () && map.find ("x") == map.end ());
+}
+
+/**
+ * The arena holds the bytes of the live keys, erased bytes are dropped once they outnumber them
+ */
+static void testCompaction ()
+{
+    InternedStringMap<int> map;
+    std::string longKey (100 , 'a');
+    for (int i = 0 ; i < 1000 ; ++ i)
+    {
+        map.insert (longKey + std::to_string (i) , i);
+    }
+    size_t full = map.keyBytes ();
+    CHECK (full >= 1000 * longKey.size ());
+    for (int i = 0 ; i < 990 ; ++ i)
+    {
+        map.erase (longKey + std::to_string (i));
+    }
+    CHECK (map.size () == 10);
+    CHECK (map.keyBytes () < full / 2);
+    bool found = true;
+    for (int i = 990 ; i < 1000 ; ++ i)
+    {
+        found = found && map.at (longKey + std::to_string (i)) == i;
+    }
+    CHECK (found);
+}
+
+int main ()
+{
+    testAgainstMap ();
+    testMissing ();
+    testCompaction ();
+    return testResult ();
+}
@@ -0,0 +1,43 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+
+#ifndef CPPEX3_TESTUTILS_HPP
+#define CPPEX3_TESTUTILS_HPP
+//---------------DEFINES--------------
+#define CHECK(...) checkThat ((__VA_ARGS__) , #__VA_ARGS__ , __FILE__ , __LINE__)
+
+#include <cstdlib>
+#include <iostream>
+
+/**
+ * Amount of failed checks so far
+ */
+inline int failures = 0;
+
+/**
+ * Records a failed check, a test keeps running after a failure so every failure is reported
+ * @param condition Result of the check
+ * @param text Text of the check
+ * @param file File of the check
+ * @param line Line of the check
+ */
+inline void checkThat (bool condition , const char *text , const char *file , int line)
+{
+    if (! condition)
+    {
+        std::cerr << file << ":" << line << ": check failed: " << text << std::endl;
+        ++ failures;
+    }
+}
+
+/**
+ * Exit code of a test
+ * @return EXIT_FAILURE if a check failed 0 otherwise
+ */
+inline int testResult ()
+{
+    return failures == 0 ? 0 : EXIT_FAILURE;
+}
+
+#endif //CPPEX3_TESTUTILS_HPP
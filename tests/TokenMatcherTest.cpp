@@ -0,0 +1,202 @@
+//
+// Created by mikemerzl on 20/01/2020.
+//
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "../TokenMatcher.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * Bytes of the random phrases and messages: letters of both cases, a digit, separators and the
+ * two bytes of a non ASCII letter
+ */
+static const std::string ALPHABET = "abAB1 ,.\xc3\xa9-";
+
+/**
+ * Scores a message by splitting it into tokens and looking every window up by its text
+ * @param phrases Normalized phrases and their summed scores
+ * @param message Message to score
+ * @return Score of the message
+ */
+static int naiveScore (const std::map<std::string , int> & phrases , const std::string & message)
+{
+    std::vector<std::string> tokens;
+    std::string token;
+    for (char c : message + " ")
+    {
+        c = (char) std::tolower ((unsigned char) c);
+        if (TokenMatcher::isTokenByte ((unsigned char) c))
+        {
+            token += c;
+        }
+        else if (! token.empty ())
+        {
+            tokens.push_back (token);
+            token.clear ();
+        }
+    }
+    int score = 0;
+    for (size_t end = 0 ; end < tokens.size () ; ++ end)
+    {
+        std::string window;
+        for (size_t start = end + 1 ; start-- > 0 ; )
+        {
+            window = start == end ? tokens[end] : tokens[start] + " " + window;
+            auto found = phrases.find (window);
+            if (found != phrases.end ())
+            {
+                score += found->second;
+            }
+        }
+    }
+    return score;
+}
+
+/**
+ * Random phrases and messages score like the naive split, with and without a filter, whole,
+ * in random chunks and when stopping at a limit
+ */
+static void testAgainstNaive ()
+{
+    std::mt19937 random (7);
+    auto randomText = [&random] (size_t length)
+    {
+        std::string text;
+        for (size_t i = 0 ; i < length ; ++ i)
+        {
+            text += ALPHABET[random () % ALPHABET.size ()];
+        }
+        return text;
+    };
+    bool same = true;
+    for (int round = 0 ; round < 3000 ; ++ round)
+    {
+        PatternTable table;
+        for (int i = 1 + (int) (random () % 8) ; i > 0 ; -- i)
+        {
+            std::string phrase = randomText (1 + random () % 7);
+            std::transform (phrase.begin () , phrase.end () , phrase.begin () , [] (char c)
+            { return (char) std::tolower ((unsigned char) c); });
+            table.insert (phrase , 1 + (int) (random () % 5));
+        }
+        std::map<std::string , int> phrases;
+        for (const auto & pair : table)
+        {
+            std::string normalized = TokenMatcher::normalize (pair.first);
+            if (! normalized.empty ())
+            {
+                phrases[normalized] += pair.second;
+            }
+        }
+        TokenMatcher matcher (table , round % 2 ? 0.01 : 0);
+        std::string message = randomText (random () % 300);
+        int expected = naiveScore (phrases , message);
+        TokenMatcher::Scanner whole (matcher);
+        whole.feed (message.data () , message.size ());
+        whole.finish ();
+        same = same && whole.score () == expected;
+        TokenMatcher::Scanner chunked (matcher);
+        for (size_t at = 0 ; at < message.size () ; )
+        {
+            size_t chunk = std::min (message.size () - at , (size_t) (random () % 20));
+            at += chunked.feed (message.data () + at , chunk);
+        }
+        chunked.finish ();
+        same = same && chunked.score () == expected;
+        if (expected > 0)
+        {
+            int limit = 1 + (int) (random () % expected);
+            TokenMatcher::Scanner limited (matcher , limit);
+            size_t used = limited.feed (message.data () , message.size ());
+            limited.finish ();
+            TokenMatcher::Scanner prefix (matcher , limit);
+            prefix.feed (message.data () , used);
+            prefix.finish ();
+            same = same && limited.reached () && used <= message.size () && prefix.reached ();
+        }
+    }
+    CHECK (same);
+}
+
+/**
+ * Whole tokens only, case and separators do not matter, and a message longer than a block
+ * scores every window that crosses a block boundary
+ */
+static void testTokens ()
+{
+    PatternTable table;
+    table.insert ("buy now" , 3);
+    table.insert ("buy  now!" , 2);
+    table.insert ("free" , 1);
+    TokenMatcher matcher (table);
+    CHECK (matcher.size () == 2 && matcher.maxTokens () == 2 && matcher.isFrozen ());
+    CHECK (TokenMatcher::normalize ("  Buy,, NOW ") == "buy now");
+    const std::pair<const char * , int> messages[] = {{"Buy, NOW" , 5} , {"buy nowhere" , 0} ,
+                                                      {"freebie free" , 1} , {"rebuy now" , 0} ,
+                                                      {"" , 0}};
+    for (const auto & message : messages)
+    {
+        TokenMatcher::Scanner scanner (matcher);
+        scanner.feed (message.first , std::string (message.first).size ());
+        scanner.finish ();
+        CHECK (scanner.score () == message.second);
+    }
+    std::string line = "Buy  NOW, free! freebie ";
+    std::string big;
+    while (big.size () < 4 * TOKEN_BLOCK)
+    {
+        big += line;
+    }
+    TokenMatcher::Scanner scanner (matcher);
+    scanner.feed (big.data () , big.size ());
+    scanner.finish ();
+    CHECK (scanner.score () == (int) (big.size () / line.size ()) * 6);
+    CHECK (scanner.hits () == 2 * (big.size () / line.size ()));
+}
+
+/**
+ * Tokens and separator runs many blocks long, fed in small chunks: a token longer than every
+ * phrase token breaks the windows around it, separators do not, a phrase token cut by a chunk
+ * still matches, and the buffer stays bounded all along
+ */
+static void testLongRuns ()
+{
+    PatternTable table;
+    table.insert ("buy now" , 3);
+    table.insert ("free" , 1);
+    table.insert ("abcdefghij" , 5);
+    TokenMatcher matcher (table);
+    CHECK (matcher.maxTokenLength () == 10);
+    const std::string longToken (5 * TOKEN_BLOCK , 'a');
+    const std::string longSpace (5 * TOKEN_BLOCK , ' ');
+    const std::pair<std::string , int> messages[] = {
+            {"buy " + longToken + " now free" , 1} , {"buy" + longSpace + "NOW" , 3} ,
+            {longToken + "abcdefghij" , 0} , {longToken + " abcdefghij " + longToken , 5} ,
+            {"free " + longToken , 1}};
+    for (const auto & message : messages)
+    {
+        TokenMatcher::Scanner scanner (matcher);
+        size_t largest = 0;
+        for (size_t fed = 0 ; fed < message.first.size () ; fed += 1000)
+        {
+            scanner.feed (message.first.data () + fed ,
+                          std::min ((size_t) 1000 , message.first.size () - fed));
+            largest = std::max (largest , scanner.buffered ());
+        }
+        scanner.finish ();
+        CHECK (scanner.score () == message.second);
+        CHECK (largest <= 1000 + matcher.maxTokens () * matcher.maxTokenLength ());
+    }
+}
+
+int main ()
+{
+    testAgainstNaive ();
+    testTokens ();
+    testLongRuns ();
+    return testResult ();
+}